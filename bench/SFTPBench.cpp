@@ -0,0 +1,497 @@
+#include "Common.hpp"
+
+#include "system/Config.hpp"
+#include "system/System.hpp"
+#include "system/SSHSFTP.hpp"
+
+#include <libssh/libssh.h>
+#include <libssh/server.h>
+#include <libssh/sftp.h>
+
+#include <chrono>
+#include <cstdio>
+#include <iomanip>
+#include <random>
+#include <sstream>
+#include <thread>
+
+/* File types, as transmitted in the permissions of SFTP attributes. */
+#define S_IFDIR_TH   0040000
+#define S_IFREG_TH   0100000
+#define S_IFLNK_TH   0120000
+
+class BenchConfig : public Config {
+public:
+
+	explicit BenchConfig(const std::vector<std::string> & argv) : Config(argv) {
+
+		for(const auto & arg : arguments()) {
+			if(arg.values.empty()){
+				continue;
+			}
+			try {
+				if(arg.key == "files"){
+					files = uint((std::max)(std::stoi(arg.values[0]), 1));
+				}
+				if(arg.key == "dirs"){
+					dirs = uint((std::max)(std::stoi(arg.values[0]), 1));
+				}
+				if(arg.key == "size"){
+					size = uint((std::max)(std::stoi(arg.values[0]), 0));
+				}
+				if(arg.key == "latency"){
+					latency = (std::max)(std::stod(arg.values[0]), 0.0);
+				}
+				if(arg.key == "bandwidth"){
+					bandwidth = (std::max)(std::stod(arg.values[0]), 0.0);
+				}
+				if(arg.key == "port"){
+					port = std::stoi(arg.values[0]);
+				}
+			} catch(...) {
+				Log::Error() << Log::Config << "Invalid value for argument " << arg.key << "." << std::endl;
+				valid = false;
+			}
+		}
+
+		registerSection("Synthetic output");
+		registerArgument("files", "", "Number of files to upload (200 by default).", "count");
+		registerArgument("dirs", "", "Number of directories the files are spread in (10 by default).", "count");
+		registerArgument("size", "", "Average size of each file (16KB by default), sizes are picked between half and twice this value.", "KB");
+
+		registerSection("Loopback server");
+		registerArgument("latency", "", "Delay added before answering each request (20ms by default).", "ms");
+		registerArgument("bandwidth", "", "Maximum rate at which written data is accepted (unlimited by default).", "KB/s");
+		registerArgument("port", "", "Port the server listens to on 127.0.0.1 (2222 by default).", "port");
+	}
+
+	uint files = 200;
+	uint dirs = 10;
+	uint size = 16;
+	double latency = 20.0;
+	double bandwidth = 0.0;
+	int port = 2222;
+	bool valid = true;
+};
+
+/**
+ \brief SFTP server running on the loopback interface in a background thread, storing files in a local directory. Answers are delayed to emulate the latency and bandwidth of a real network.
+ */
+class LoopbackServer {
+public:
+
+	/** Constructor.
+	 \param root the local directory exposed as the server root
+	 \param latency delay before answering each request, in milliseconds
+	 \param bandwidth maximum rate of written data, in KB/s, or 0 for no limit
+	 */
+	LoopbackServer(const fs::path & root, double latency, double bandwidth) : _root(root), _latency(latency), _bandwidth(bandwidth) {}
+
+	~LoopbackServer();
+
+	/** Start listening and serve a single connection in the background.
+	 \param port the port to listen to
+	 \param knownHosts file that will list the server key, for the client to trust it
+	 \return true if the server is listening
+	 */
+	bool start(int port, const fs::path & knownHosts);
+
+	/// Wait for the served connection to end.
+	void stop();
+
+private:
+
+	/// \brief Open file or directory.
+	struct Handle {
+		FILE * file = nullptr;
+		std::vector<fs::path> entries; ///< Remaining directory entries.
+		bool directory = false;
+	};
+
+	void serve();
+
+	void process(sftp_session sftp, sftp_client_message msg);
+
+	fs::path resolve(const char * path) const;
+
+	void wait(double milliseconds) const;
+
+	ssh_bind _bind = nullptr;
+	std::thread _thread;
+	fs::path _root;
+	double _latency;
+	double _bandwidth;
+};
+
+LoopbackServer::~LoopbackServer(){
+	stop();
+	if(_bind){
+		ssh_bind_free(_bind);
+	}
+}
+
+bool LoopbackServer::start(int port, const fs::path & knownHosts){
+	ssh_init();
+	ssh_key key = nullptr;
+	if(ssh_pki_generate(SSH_KEYTYPE_ED25519, 0, &key) != SSH_OK){
+		Log::Error() << Log::Server << "Unable to generate the server key." << std::endl;
+		return false;
+	}
+	// Register the key as known for the loopback address.
+	char * keyString = nullptr;
+	if(ssh_pki_export_pubkey_base64(key, &keyString) != SSH_OK){
+		ssh_key_free(key);
+		return false;
+	}
+	const std::string entry = "[127.0.0.1]:" + std::to_string(port) + " " + ssh_key_type_to_char(ssh_key_type(key)) + " " + keyString + "\n";
+	ssh_string_free_char(keyString);
+	System::writeStringToFile(entry, knownHosts);
+
+	_bind = ssh_bind_new();
+	const std::string address = "127.0.0.1";
+	ssh_bind_options_set(_bind, SSH_BIND_OPTIONS_BINDADDR, address.c_str());
+	ssh_bind_options_set(_bind, SSH_BIND_OPTIONS_BINDPORT, &port);
+	ssh_bind_options_set(_bind, SSH_BIND_OPTIONS_IMPORT_KEY, key);
+	if(ssh_bind_listen(_bind) != SSH_OK){
+		Log::Error() << Log::Server << "Unable to listen on port " << port << ": " << ssh_get_error(_bind) << std::endl;
+		return false;
+	}
+	_thread = std::thread(&LoopbackServer::serve, this);
+	return true;
+}
+
+void LoopbackServer::stop(){
+	if(_thread.joinable()){
+		_thread.join();
+	}
+}
+
+void LoopbackServer::serve(){
+	ssh_session session = ssh_new();
+	if(ssh_bind_accept(_bind, session) != SSH_OK || ssh_handle_key_exchange(session) != SSH_OK){
+		Log::Error() << Log::Server << "Unable to accept connection: " << ssh_get_error(session) << std::endl;
+		ssh_free(session);
+		return;
+	}
+
+	// Accept any password, then wait for the SFTP subsystem to be requested.
+	ssh_channel channel = nullptr;
+	bool authenticated = false;
+	bool subsystem = false;
+	while(!subsystem){
+		ssh_message message = ssh_message_get(session);
+		if(!message){
+			break;
+		}
+		const int type = ssh_message_type(message);
+		const int subtype = ssh_message_subtype(message);
+		if(type == SSH_REQUEST_SERVICE){
+			ssh_message_service_reply_success(message);
+		} else if(type == SSH_REQUEST_AUTH && subtype == SSH_AUTH_METHOD_PASSWORD){
+			authenticated = true;
+			ssh_message_auth_reply_success(message, 0);
+		} else if(type == SSH_REQUEST_AUTH){
+			ssh_message_auth_set_methods(message, SSH_AUTH_METHOD_PASSWORD);
+			ssh_message_reply_default(message);
+		} else if(authenticated && type == SSH_REQUEST_CHANNEL_OPEN && subtype == SSH_CHANNEL_SESSION){
+			channel = ssh_message_channel_request_open_reply_accept(message);
+		} else if(channel && type == SSH_REQUEST_CHANNEL && subtype == SSH_CHANNEL_REQUEST_SUBSYSTEM
+				  && std::string(ssh_message_channel_request_subsystem(message)) == "sftp"){
+			subsystem = true;
+			ssh_message_channel_request_reply_success(message);
+		} else {
+			ssh_message_reply_default(message);
+		}
+		ssh_message_free(message);
+	}
+
+	if(subsystem){
+		sftp_session sftp = sftp_server_new(session, channel);
+		if(sftp && sftp_server_init(sftp) == 0){
+			while(sftp_client_message msg = sftp_get_client_message(sftp)){
+				process(sftp, msg);
+				sftp_client_message_free(msg);
+			}
+		}
+		if(sftp){
+			sftp_server_free(sftp);
+		}
+	}
+	if(channel){
+		ssh_channel_free(channel);
+	}
+	ssh_disconnect(session);
+	ssh_free(session);
+}
+
+fs::path LoopbackServer::resolve(const char * path) const {
+	return _root / fs::path(path ? path : "").relative_path();
+}
+
+void LoopbackServer::wait(double milliseconds) const {
+	if(milliseconds > 0.0){
+		std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(milliseconds));
+	}
+}
+
+void LoopbackServer::process(sftp_session sftp, sftp_client_message msg){
+	wait(_latency);
+
+	const auto attributes = [](const fs::file_status & status, uint64_t size){
+		struct sftp_attributes_struct attr{};
+		attr.flags = SSH_FILEXFER_ATTR_SIZE | SSH_FILEXFER_ATTR_PERMISSIONS;
+		attr.size = size;
+		attr.permissions = uint32_t(status.permissions() & fs::perms::mask);
+		if(fs::is_directory(status)){
+			attr.permissions |= S_IFDIR_TH;
+		} else if(fs::is_symlink(status)){
+			attr.permissions |= S_IFLNK_TH;
+		} else {
+			attr.permissions |= S_IFREG_TH;
+		}
+		return attr;
+	};
+	const auto replyResult = [msg](bool success){
+		return sftp_reply_status(msg, success ? SSH_FX_OK : SSH_FX_FAILURE, nullptr);
+	};
+
+	std::error_code ec;
+	const uint8_t type = sftp_client_message_get_type(msg);
+	switch(type){
+		case SSH_FXP_REALPATH: {
+			const std::string path = "/" + fs::path(sftp_client_message_get_filename(msg)).relative_path().lexically_normal().generic_string();
+			sftp_reply_name(msg, path.c_str(), nullptr);
+			break;
+		}
+		case SSH_FXP_STAT:
+		case SSH_FXP_LSTAT: {
+			const fs::path path = resolve(sftp_client_message_get_filename(msg));
+			const fs::file_status status = type == SSH_FXP_STAT ? fs::status(path, ec) : fs::symlink_status(path, ec);
+			if(ec || !fs::exists(status)){
+				sftp_reply_status(msg, SSH_FX_NO_SUCH_FILE, nullptr);
+				break;
+			}
+			struct sftp_attributes_struct attr = attributes(status, fs::is_regular_file(status) ? fs::file_size(path, ec) : 0);
+			sftp_reply_attr(msg, &attr);
+			break;
+		}
+		case SSH_FXP_OPEN: {
+			const fs::path path = resolve(sftp_client_message_get_filename(msg));
+			const uint32_t flags = sftp_client_message_get_flags(msg);
+			const bool create = (flags & SSH_FXF_TRUNC) || ((flags & SSH_FXF_CREAT) && !fs::exists(path, ec));
+			FILE * file = std::fopen(path.string().c_str(), create ? "w+b" : ((flags & SSH_FXF_WRITE) ? "r+b" : "rb"));
+			if(!file){
+				sftp_reply_status(msg, SSH_FX_NO_SUCH_FILE, nullptr);
+				break;
+			}
+			Handle * handle = new Handle();
+			handle->file = file;
+			ssh_string id = sftp_handle_alloc(sftp, handle);
+			sftp_reply_handle(msg, id);
+			ssh_string_free(id);
+			break;
+		}
+		case SSH_FXP_OPENDIR: {
+			const fs::path path = resolve(sftp_client_message_get_filename(msg));
+			if(!fs::is_directory(path, ec)){
+				sftp_reply_status(msg, SSH_FX_NO_SUCH_FILE, nullptr);
+				break;
+			}
+			Handle * handle = new Handle();
+			handle->directory = true;
+			for(const auto & entry : fs::directory_iterator(path, ec)){
+				handle->entries.push_back(entry.path());
+			}
+			ssh_string id = sftp_handle_alloc(sftp, handle);
+			sftp_reply_handle(msg, id);
+			ssh_string_free(id);
+			break;
+		}
+		case SSH_FXP_READDIR: {
+			Handle * handle = static_cast<Handle*>(sftp_handle(sftp, msg->handle));
+			if(!handle || !handle->directory){
+				sftp_reply_status(msg, SSH_FX_FAILURE, nullptr);
+				break;
+			}
+			if(handle->entries.empty()){
+				sftp_reply_status(msg, SSH_FX_EOF, nullptr);
+				break;
+			}
+			// Send entries in batches, as OpenSSH does.
+			const size_t count = (std::min)(handle->entries.size(), size_t(100));
+			for(size_t i = 0; i < count; ++i){
+				const fs::path & entry = handle->entries[handle->entries.size() - 1 - i];
+				const fs::file_status status = fs::symlink_status(entry, ec);
+				struct sftp_attributes_struct attr = attributes(status, fs::is_regular_file(status) ? fs::file_size(entry, ec) : 0);
+				const std::string name = entry.filename().string();
+				sftp_reply_names_add(msg, name.c_str(), name.c_str(), &attr);
+			}
+			handle->entries.resize(handle->entries.size() - count);
+			sftp_reply_names(msg);
+			break;
+		}
+		case SSH_FXP_WRITE: {
+			Handle * handle = static_cast<Handle*>(sftp_handle(sftp, msg->handle));
+			if(!handle || !handle->file){
+				sftp_reply_status(msg, SSH_FX_FAILURE, nullptr);
+				break;
+			}
+			const size_t size = ssh_string_len(msg->data);
+			if(_bandwidth > 0.0){
+				wait(double(size) / 1024.0 / _bandwidth * 1000.0);
+			}
+			const bool success = std::fseek(handle->file, long(msg->offset), SEEK_SET) == 0
+				&& std::fwrite(ssh_string_data(msg->data), 1, size, handle->file) == size;
+			replyResult(success);
+			break;
+		}
+		case SSH_FXP_READ: {
+			Handle * handle = static_cast<Handle*>(sftp_handle(sftp, msg->handle));
+			if(!handle || !handle->file || std::fseek(handle->file, long(msg->offset), SEEK_SET) != 0){
+				sftp_reply_status(msg, SSH_FX_FAILURE, nullptr);
+				break;
+			}
+			std::vector<char> data(msg->len);
+			const size_t size = std::fread(data.data(), 1, data.size(), handle->file);
+			if(size == 0){
+				sftp_reply_status(msg, SSH_FX_EOF, nullptr);
+			} else {
+				sftp_reply_data(msg, data.data(), int(size));
+			}
+			break;
+		}
+		case SSH_FXP_CLOSE: {
+			Handle * handle = static_cast<Handle*>(sftp_handle(sftp, msg->handle));
+			if(!handle){
+				sftp_reply_status(msg, SSH_FX_FAILURE, nullptr);
+				break;
+			}
+			if(handle->file){
+				std::fclose(handle->file);
+			}
+			sftp_handle_remove(sftp, handle);
+			delete handle;
+			replyResult(true);
+			break;
+		}
+		case SSH_FXP_MKDIR:
+			replyResult(fs::create_directory(resolve(sftp_client_message_get_filename(msg)), ec));
+			break;
+		case SSH_FXP_RMDIR:
+		case SSH_FXP_REMOVE:
+			replyResult(fs::remove(resolve(sftp_client_message_get_filename(msg)), ec));
+			break;
+		case SSH_FXP_RENAME:
+			fs::rename(resolve(sftp_client_message_get_filename(msg)), resolve(sftp_client_message_get_data(msg)), ec);
+			replyResult(!ec);
+			break;
+		case SSH_FXP_SYMLINK:
+			// The target is kept as is, as relative links are resolved by the filesystem.
+			fs::create_symlink(sftp_client_message_get_filename(msg), resolve(sftp_client_message_get_data(msg)), ec);
+			replyResult(!ec);
+			break;
+		case SSH_FXP_READLINK: {
+			const fs::path target = fs::read_symlink(resolve(sftp_client_message_get_filename(msg)), ec);
+			if(ec){
+				sftp_reply_status(msg, SSH_FX_NO_SUCH_FILE, nullptr);
+				break;
+			}
+			sftp_reply_name(msg, target.generic_string().c_str(), nullptr);
+			break;
+		}
+		default:
+			sftp_reply_status(msg, SSH_FX_OP_UNSUPPORTED, nullptr);
+			break;
+	}
+}
+
+/** Generate a synthetic output tree of random files.
+ \param root the directory to populate
+ \param config the tree dimensions
+ \return the total size of the files, in bytes
+ */
+uint64_t generateTree(const fs::path & root, const BenchConfig & config){
+	std::mt19937 rng(config.files);
+	std::uniform_int_distribution<uint> sizes(config.size * 512, config.size * 2048);
+	uint64_t total = 0;
+	for(uint fid = 0; fid < config.files; ++fid){
+		const fs::path dir = root / ("dir-" + std::to_string(fid % config.dirs));
+		System::createDirectory(dir);
+		std::string content(sizes(rng), ' ');
+		for(char & c : content){
+			c = char('a' + rng() % 26);
+		}
+		System::writeStringToFile(content, dir / ("file-" + std::to_string(fid) + ".html"));
+		total += content.size();
+	}
+	return total;
+}
+
+/** Log the cost of an upload phase.
+ \param name the phase name
+ \param target the upload target, its statistics are then reset
+ \param files the number of files processed
+ \param bytes the amount of data processed
+ */
+void report(const std::string & name, Server & target, uint files, uint64_t bytes){
+	const DeployTarget::Stats & stats = target.stats();
+	const double duration = (std::max)(stats.duration(), 1e-6);
+	std::stringstream str;
+	str << std::fixed << std::setprecision(1) << name << ": " << files << " files in " << duration << "s, ";
+	str << (double(files) / duration) << " files/s, " << (double(bytes) / 1024.0 / 1024.0 / duration) << " MB/s, " << stats.roundTrips() << " round trips.";
+	Log::Info() << Log::Upload << str.str() << std::endl;
+	Log::Info() << Log::Upload << stats.str() << std::endl;
+	target.resetStats();
+}
+
+int main(int argc, char** argv){
+
+	BenchConfig config(std::vector<std::string>(argv, argv+argc));
+	if(config.showHelp(!config.valid)){
+		return config.valid ? 0 : 1;
+	}
+
+	const fs::path root = fs::temp_directory_path() / ("thoth-bench-" + std::to_string(std::chrono::system_clock::now().time_since_epoch().count()));
+	const fs::path output = root / "output";
+	const uint64_t bytes = generateTree(output, config);
+	System::createDirectory(root / "remote");
+
+	std::stringstream setup;
+	setup << "Uploading " << config.files << " files (" << (bytes / 1024) << " KB) to 127.0.0.1:" << config.port;
+	setup << " with " << config.latency << "ms of latency";
+	if(config.bandwidth > 0.0){
+		setup << " and " << config.bandwidth << " KB/s of bandwidth";
+	}
+	Log::Info() << Log::Upload << setup.str() << "." << std::endl;
+
+	LoopbackServer server(root / "remote", config.latency, config.bandwidth);
+	if(!server.start(config.port, root / "known_hosts")){
+		System::removeItem(root);
+		return 1;
+	}
+	int result = 0;
+	{
+		Server target("127.0.0.1", "bench", config.port, root / "known_hosts");
+		if(target.authenticate("bench")){
+			const fs::path site = "/site";
+			std::vector<DeployTarget::Item> items;
+			target.resetStats();
+			target.copyItem(output, site, false);
+			report("Initial upload", target, config.files, bytes);
+			target.copyItem(output, site, false);
+			report("Unchanged upload", target, config.files, 0);
+			target.copyItem(output, site, true);
+			report("Forced upload", target, config.files, bytes);
+			target.listItems(site, true, items);
+			report("Listing", target, uint(items.size()), 0);
+			target.removeItem(site);
+			report("Removal", target, config.files, 0);
+		} else {
+			result = 1;
+		}
+		target.disconnect();
+	}
+	server.stop();
+	System::removeItem(root);
+	return result;
+}
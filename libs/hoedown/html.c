@@ -95,9 +95,24 @@ rndr_autolink(hoedown_buffer *ob, const hoedown_buffer *link, hoedown_autolink_t
 static void
 rndr_blockcode(hoedown_buffer *ob, const hoedown_buffer *text, const hoedown_buffer *lang, const hoedown_renderer_data *data)
 {
-	(void)data;
+	hoedown_html_renderer_state *state = data->opaque;
 	if (ob->size) hoedown_buffer_putc(ob, '\n');
 
+	/* highlighted code is marked so that client-side highlighters skip it */
+	if (lang && text && state->highlight) {
+		hoedown_buffer *highlighted = hoedown_buffer_new(text->size * 2 + 64);
+		if (state->highlight(state->opaque, highlighted, text->data, text->size, lang->data, lang->size)) {
+			HOEDOWN_BUFPUTSL(ob, "<pre><code class=\"hljs language-");
+			escape_html(ob, lang->data, lang->size);
+			HOEDOWN_BUFPUTSL(ob, "\">");
+			hoedown_buffer_put(ob, highlighted->data, highlighted->size);
+			HOEDOWN_BUFPUTSL(ob, "</code></pre>\n");
+			hoedown_buffer_free(highlighted);
+			return;
+		}
+		hoedown_buffer_free(highlighted);
+	}
+
 	if (lang) {
 		HOEDOWN_BUFPUTSL(ob, "<pre><code class=\"language-");
 		escape_html(ob, lang->data, lang->size);
@@ -461,12 +476,43 @@ rndr_image(hoedown_buffer *ob, const hoedown_buffer *link, const hoedown_buffer
 	}
 	
 	// Use title as width for the image.
+	const hoedown_buffer *display_width = NULL;
 	if(state->title_as_size && title && title->size){
-		HOEDOWN_BUFPUTSL(ob, "\" width=\"");
-		escape_html(ob, title->data, title->size);
+		display_width = title;
 	} else if(media_opts && media_opts->size) {
+		display_width = media_opts;
+	}
+	int img_width = 0;
+	int img_height = 0;
+	const int has_size = state->image_size && state->image_size(state->opaque, link->data, link->size, &img_width, &img_height) && img_width > 0 && img_height > 0;
+
+	if(display_width){
 		HOEDOWN_BUFPUTSL(ob, "\" width=\"");
-		escape_html(ob, media_opts->data, media_opts->size);
+		escape_html(ob, display_width->data, display_width->size);
+		// Reserve space for the image with its aspect ratio.
+		if(has_size){
+			size_t i = 0;
+			long value = 0;
+			while(i < display_width->size && isdigit(display_width->data[i])){
+				value = value * 10 + (display_width->data[i] - '0');
+				++i;
+			}
+			if(i == display_width->size && value > 0){
+				hoedown_buffer_printf(ob, "\" height=\"%ld", (value * img_height + img_width / 2) / img_width);
+			} else {
+				hoedown_buffer_printf(ob, "\" style=\"aspect-ratio: %d / %d", img_width, img_height);
+			}
+		}
+	} else if(has_size){
+		hoedown_buffer_printf(ob, "\" width=\"%d\" height=\"%d", img_width, img_height);
+	}
+
+	if(state->image_size){
+		// The first image is probably visible when the page loads, others and comparisons are loaded when needed.
+		if(state->image_count > 0 || !in_figure){
+			HOEDOWN_BUFPUTSL(ob, "\" loading=\"lazy\" decoding=\"async");
+		}
+		state->image_count++;
 	}
 	
 	if(state->title_as_size == 0 && title && title->size){
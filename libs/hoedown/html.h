@@ -49,6 +49,13 @@ struct hoedown_html_renderer_state {
 	void (*link_attributes)(hoedown_buffer *ob, const hoedown_buffer *url, const hoedown_renderer_data *data);
 	
 	int title_as_size;
+
+	/* image size callback, returns 1 if the intrinsic size of the image is known */
+	int (*image_size)(void *opaque, const uint8_t *link, size_t link_size, int *width, int *height);
+	int image_count;
+
+	/* code highlighting callback, returns 1 if escaped and highlighted code was written to the buffer */
+	int (*highlight)(void *opaque, hoedown_buffer *ob, const uint8_t *code, size_t code_size, const uint8_t *lang, size_t lang_size);
 	
 };
 typedef struct hoedown_html_renderer_state hoedown_html_renderer_state;
@@ -1,4 +1,7 @@
-
+newoption {
+   trigger     = "with-bench",
+   description = "Add the SFTPBench project, measuring uploads to a local SFTP server"
+}
 
 workspace("Thoth")
 	-- Configuration.
@@ -58,7 +61,7 @@ workspace("Thoth")
 				libsecretLibs = string.explode(string.gsub(listing, "-l", ""), " ")
 			end
 			buildoptions( libsecretFlags )
-			links({"ssh"})
+			links({"ssh", "pthread", "z"})
 			links( libsecretLibs )
 
 		-- visual studio filters
@@ -66,6 +69,46 @@ workspace("Thoth")
 			defines({ "_CRT_SECURE_NO_WARNINGS" })  
 		filter({})
 
+	-- Optional benchmark running the uploader against a loopback SFTP server.
+	if _OPTIONS["with-bench"] then
+	project("SFTPBench")
+		kind("ConsoleApp")
+
+		language("C++")
+		cppdialect("C++17")
+		systemversion("latest")
+		defines({ "WITH_SERVER" })
+		-- Compiler flags
+		filter("toolset:not msc*")
+			buildoptions({ "-Wall", "-Wextra" })
+		filter("toolset:msc*")
+			buildoptions({ "-W3"})
+		filter({})
+		includedirs({"src/"})
+		sysincludedirs({ "libs/" })
+
+		-- Everything but the tool entry point.
+		files({"bench/**", "src/**", "libs/**"})
+		removefiles({"src/main.cpp", "**.DS_STORE", "**.thumbs"})
+
+		filter("system:macosx")
+			sysincludedirs({ "libs/libssh/macos/include" })
+			libdirs({"libs/libssh/macos/lib/"})
+			links({"ssh", "ssl", "z", "crypto", "Security.framework"})
+		filter("system:windows")
+			sysincludedirs({ "libs/libssh/win/include" })
+			libdirs({"libs/libssh/win/lib/"})
+			links({"ssh", "mbedcrypto", "mbedtls", "mbedx509", "wsock32", "ws2_32", "pthreadVC3", "Advapi32"})
+		filter("system:linux")
+			buildoptions( libsecretFlags )
+			links({"ssh", "pthread", "z"})
+			links( libsecretLibs )
+
+		filter("action:vs*")
+			defines({ "_CRT_SECURE_NO_WARNINGS" })
+		filter({})
+	end
+
 newaction {
    trigger     = "clean",
    description = "Clean the build directory",
@@ -1,10 +1,20 @@
 #include "Generator.hpp"
 #include "system/TextUtilities.hpp"
 #include "system/System.hpp"
+#include "system/Minifier.hpp"
+#include "system/Image.hpp"
+#include "system/CriticalStyles.hpp"
+#include "system/Highlighter.hpp"
+#include "system/SearchIndex.hpp"
+#include "system/MinHash.hpp"
 
 #include <hoedown/html.h>
 #include <hoedown/document.h>
 #include <map>
+#include <sstream>
+#include <fstream>
+#include <iomanip>
+#include <unordered_set>
 #include <array>
 
 #ifdef __linux__
@@ -13,21 +23,36 @@ const std::string EN_US_LOCALE = "en_US.UTF8";
 const std::string EN_US_LOCALE = "en_US";
 #endif
 
-Generator::Generator(const Settings & settings) : _settings(settings) {
+/// Type of the images that can be embedded in pages, empty for other files.
+static std::string imageMimeType(const fs::path & path){
+	const std::string ext = TextUtilities::lowercase(path.extension().string());
+	if(ext == ".png" || ext == ".gif" || ext == ".webp"){
+		return "image/" + ext.substr(1);
+	}
+	if(ext == ".jpg" || ext == ".jpeg"){
+		return "image/jpeg";
+	}
+	if(ext == ".svg"){
+		return "image/svg+xml";
+	}
+	return "";
+}
+
+/// Template files that can be minified and renamed after their content.
+static bool isFingerprintedAsset(const fs::path & path){
+	const std::string ext = TextUtilities::lowercase(path.extension().string());
+	return ext == ".css" || ext == ".js";
+}
+
+Generator::Generator(const Settings & settings) : _settings(settings),
+	_manifest(settings.outputPath() / ".manifest"), _copier(settings.outputPath(), _manifest, settings.hardLinkResources()),
+	_sourceHashes(settings.outputPath() / ".sources") {
 	// Create markdown generator based on settings.
 	
 	// Initialize output directory.
 	System::createDirectory(settings.outputPath());
 	
-	// Start by checking and updating the template.
-	const auto templateFiles = System::listItems(settings.templatePath(), false, false);
-	for(const auto & file : templateFiles){
-		const fs::path dstPath = settings.outputPath() / file.filename();
-		// Copy item.
-		System::copyItem(file, dstPath, true);
-	}
-
-	// Load template data and cleanup from output dir.
+	// Load template data.
 	// 
 	// Standard template data.
 
@@ -59,9 +84,8 @@ Generator::Generator(const Settings & settings) : _settings(settings) {
 	_template.itemFooterCategory = categHtml.substr( endPosNestedCateg + 14, endPosCateg - ( endPosNestedCateg + 14 ) );
 	_template.itemArticleCategory = categHtml.substr( insertPosNestedCateg + 16, endPosNestedCateg - ( insertPosNestedCateg + 16 ) );
 
-	System::removeItem( settings.outputPath() / "article.html" );
-	System::removeItem( settings.outputPath() / "categories.html" );
-	System::removeItem( settings.outputPath() / "index.html" );
+	// Template-only files are never copied to the output.
+	std::unordered_set<std::string> templateOnlyFiles = { "article.html", "categories.html", "index.html", "overrides" };
 
 	// Additional customizations.
 	if( System::itemExists( settings.templatePath() / "overrides" ) ) {
@@ -90,7 +114,7 @@ Generator::Generator(const Settings & settings) : _settings(settings) {
 			if( !System::itemExists( overrideFile ) ){
 				continue;
 			}
-			System::removeItem( settings.outputPath() / file );
+			templateOnlyFiles.insert( fs::path( file ).lexically_normal().generic_string() );
 			
 			const std::string overrideContent = System::loadStringFromFile( overrideFile );
 			if( overrideContent.empty() ){
@@ -99,8 +123,28 @@ Generator::Generator(const Settings & settings) : _settings(settings) {
 			_template.overrides[ key ] = overrideContent;
 
 		}
-		
-		System::removeItem( settings.outputPath() / "overrides" );
+	}
+
+	// Update the other template files in the output, only writing the ones that changed.
+	const auto templateFiles = System::listItems(settings.templatePath(), true, false);
+	std::vector<std::pair<fs::path, fs::path>> items;
+	for(const auto & file : templateFiles){
+		const fs::path relPath = file.lexically_relative(settings.templatePath());
+		// Fingerprinted assets are only written under their hashed name.
+		if(settings.fingerprintAssets() && isFingerprintedAsset(file)){
+			continue;
+		}
+		if(templateOnlyFiles.count(relPath.generic_string()) == 0){
+			items.emplace_back(file, settings.outputPath() / relPath);
+		}
+	}
+	_copier.copy(items, false);
+
+	if(settings.fingerprintAssets()){
+		fingerprintAssets(templateFiles);
+	}
+	if(settings.criticalStyles()){
+		inlineCriticalStyles();
 	}
 	
 	_buffer = hoedown_buffer_new(100);
@@ -108,9 +152,9 @@ Generator::Generator(const Settings & settings) : _settings(settings) {
 
 
 void Generator::process(const std::vector<Article> & articles, uint mode){
-	_articles = articles;
+	_articles = &articles;
 
-	std::vector<PageArticle> articlePages(_articles.size());
+	std::vector<PageArticle> articlePages(articles.size());
 	std::vector<Page> rootPages;
 	std::vector<Page> otherPages;
 
@@ -125,10 +169,81 @@ void Generator::process(const std::vector<Article> & articles, uint mode){
 		}
 	}
 
-	// Convert the markdown representation to html for each article.
+	// Related articles are only needed if the template lists them.
+	std::vector<std::vector<size_t>> related(articles.size());
+	if(_settings.relatedCount() > 0 && _template.article.find("{#RELATED}") != std::string::npos){
+		related = relatedArticles();
+	}
+
+	const bool force = bool(mode & FORCE);
+	if(mode & ARTICLES){
+		System::createDirectory(_settings.outputPath() / "articles", force);
+	}
+	if(mode & DRAFTS){
+		System::createDirectory(_settings.outputPath() / "drafts", force);
+	}
+
+	// The feed contains the content of the most recent published articles.
+	size_t publishedCount = 0;
+	for(const Article& article : articles){
+		publishedCount += size_t(article.type() == Article::Type::Public);
+	}
+	const size_t firstFeedArticle = publishedCount - (std::min)(publishedCount, size_t(_settings.rssCount()));
+
+	// Convert the markdown representation to html for each article, and save pages.
+	// With a memory budget, pages are saved in batches and their content released, only keeping what listings need.
+	const size_t budget = size_t(_settings.memoryBudget()) * 1024u * 1024u;
+	const bool indexSearch = _settings.searchIndex() && (mode & (INDEX | ARTICLES | DRAFTS));
+	SearchIndex searchIndex;
+	size_t publishedSaved = 0;
+	size_t draftsSaved = 0;
+	size_t batchStart = 0;
+	size_t batchSize = 0;
+	size_t publishedId = 0;
+	std::vector<bool> keepContent(articles.size(), true);
 	Log::Info() << Log::Generation << "Processing pages... ";
-	for(size_t aid = 0; aid < _articles.size(); ++aid){
-		renderArticlePage(_articles[aid], articlePages[aid], categories);
+	for(size_t aid = 0; aid < articles.size(); ++aid){
+		PageArticle& page = articlePages[aid];
+		renderArticlePage(articles[aid], page, categories, related[aid]);
+		const bool isPublic = articles[aid].type() == Article::Type::Public;
+		keepContent[aid] = budget == 0 || (isPublic && publishedId >= firstFeedArticle);
+		publishedId += size_t(isPublic);
+		batchSize += page.html.size() + page.innerContent.size() + page.tableOfContent.size();
+		if(aid + 1 != articles.size() && (budget == 0 || batchSize < budget)){
+			continue;
+		}
+
+		std::vector<const PageArticle*> batchPublished;
+		std::vector<const PageArticle*> batchDrafts;
+		for(size_t bid = batchStart; bid <= aid; ++bid){
+			(articlePages[bid].article->type() == Article::Type::Public ? batchPublished : batchDrafts).push_back(&articlePages[bid]);
+		}
+		if(mode & ARTICLES){
+			optimizeImages(batchPublished);
+			publishedSaved += saveArticlePages(batchPublished, _settings.outputPath(), force);
+			generateImageVariants(batchPublished);
+		}
+		if(mode & DRAFTS){
+			optimizeImages(batchDrafts);
+			draftsSaved += saveArticlePages(batchDrafts, _settings.outputPath(), force);
+			generateImageVariants(batchDrafts);
+		}
+		if(indexSearch){
+			indexArticles(batchPublished, searchIndex);
+		}
+		for(size_t bid = batchStart; bid <= aid; ++bid){
+			PageArticle& batchPage = articlePages[bid];
+			std::string().swap(batchPage.html);
+			std::string().swap(batchPage.tableOfContent);
+			if(!keepContent[bid]){
+				std::string().swap(batchPage.innerContent);
+			}
+		}
+		if(budget > 0){
+			_highlightedCode.clear();
+		}
+		batchStart = aid + 1;
+		batchSize = 0;
 	}
 	Log::Info() << "done." << std::endl;
 
@@ -144,19 +259,16 @@ void Generator::process(const std::vector<Article> & articles, uint mode){
 		}
 	}
 
-	const bool force = bool(mode & FORCE);
-	
 	if(mode & ARTICLES){
-		Log::Info() << Log::Generation << "Creating article pages... ";
-		System::createDirectory(_settings.outputPath() / "articles", force);
-		const size_t count = saveArticlePages(publishedPages, _settings.outputPath(), force);
-		Log::Info() << count << " new created pages." << std::endl;
+		Log::Info() << Log::Generation << "Creating article pages... " << publishedSaved << " new created pages." << std::endl;
+		pruneMedia(publishedPages);
 	}
 	if(mode & DRAFTS){
-		Log::Info() << Log::Generation << "Creating drafts pages... ";
-		System::createDirectory(_settings.outputPath() / "drafts", force);
-		const size_t count = saveArticlePages(draftPages, _settings.outputPath(), force);
-		Log::Info() << count << " new created pages." << std::endl;
+		Log::Info() << Log::Generation << "Creating drafts pages... " << draftsSaved << " new created pages." << std::endl;
+	}
+	// Only prune the cache when all articles have been processed.
+	if((mode & ARTICLES) && (mode & DRAFTS)){
+		pruneImageCache(articlePages);
 	}
 
 	// Generate calendar pages if requested.
@@ -183,9 +295,7 @@ void Generator::process(const std::vector<Article> & articles, uint mode){
 				const PageArticle& refPage = *(month.second[0]);
 				const std::string monthStr = refPage.article->date().value().str("%Y - %B");
 				const std::string title = " Month: " + monthStr;
-				 otherPages.emplace_back();
-				generateIndexPage(month.second, title, "../../../", "../../../index.html", otherPages.back());
-				 otherPages.back().location = refPage.location.parent_path() / "index.html";
+				generateIndexPages(month.second, title, "../../../", "../../../index.html", refPage.location.parent_path() / "index.html", "page", otherPages);
 				*/
 
 			}
@@ -193,9 +303,7 @@ void Generator::process(const std::vector<Article> & articles, uint mode){
 			const PageArticle& refPage = *(yearArticles[0]);
 			const std::string yearStr = refPage.article->date().value().str("%Y");
 			const std::string title = "Year: " + yearStr;
-			otherPages.emplace_back();
-			generateIndexPage(yearArticles, title, "../..", "../../index.html", otherPages.back());
-			otherPages.back().location = refPage.location.parent_path().parent_path() / "index.html";
+			generateIndexPages(yearArticles, title, "../..", "../../index.html", refPage.location.parent_path().parent_path() / "index.html", "page", otherPages);
 		}
 
 	}
@@ -215,9 +323,7 @@ void Generator::process(const std::vector<Article> & articles, uint mode){
 		const Category& category = categories.at(categoryKV.first);
 
 		const std::string title = "Category: " + category.name;
-		otherPages.emplace_back();
-		generateIndexPage(categoryKV.second, title, "..", "index.html", otherPages.back());
-		otherPages.back().location = category.location;
+		generateIndexPages(categoryKV.second, title, "..", "index.html", category.location, "page", otherPages);
 	}
 
 	// Save all category and calendar pages.
@@ -235,62 +341,173 @@ void Generator::process(const std::vector<Article> & articles, uint mode){
 	if(mode & (INDEX | ARTICLES | DRAFTS)){
 		Log::Info() << Log::Generation << "Generating index pages:" << std::endl;
 
-		// Four main pages: 2 index pages, a RSS feed, a sitemap.
-		rootPages.resize(5);
+		// Index pages of published articles and drafts, possibly split.
+		std::vector<Page> indexPages;
+		generateIndexPages(publishedPages, _settings.blogTitle(), ".", _settings.externalLink(), "index.html", "page", indexPages);
+		const size_t publishedIndexCount = indexPages.size();
+		// Following draft pages are stored with the drafts, so that they are never uploaded.
+		generateIndexPages(draftPages, _settings.blogTitle() + " - Drafts", ".", _settings.externalLink(), "index-drafts.html", "drafts/page", indexPages);
 
-		rootPages[0].location = fs::path("index.html");
-		generateIndexPage(publishedPages, _settings.blogTitle(), ".", _settings.externalLink(), rootPages[0]);
+		// Three other main pages: categories list, a RSS feed, a sitemap.
+		rootPages.resize(3);
 
-		rootPages[1].location = fs::path("index-drafts.html");
-		generateIndexPage(draftPages, _settings.blogTitle() + " - Drafts", ".", _settings.externalLink(), rootPages[1]);
+		rootPages[0].location = fs::path("categories/index.html");
+		generateCategoriesPage(categoryArticles, categories, _settings.blogTitle() + " - Categories", "..", "../index.html", rootPages[0]);
 
-		rootPages[2].location = fs::path("categories/index.html");
-		generateCategoriesPage(categoryArticles, categories, _settings.blogTitle() + " - Categories", "..", "../index.html", rootPages[2]);
+		rootPages[1].location = fs::path("feed.xml");
+		generateRssFeed(publishedPages, rootPages[1]);
 
-		rootPages[3].location = fs::path("feed.xml");
-		generateRssFeed(publishedPages, rootPages[3]);
-
-		rootPages[4].location = fs::path("sitemap.xml");
-		generateSitemap(publishedPages, otherPages, {&rootPages[0], &rootPages[2]}, rootPages[4]);
+		std::vector<const Page*> sitemapIndexPages;
+		for(size_t pid = 0; pid < publishedIndexCount; ++pid){
+			sitemapIndexPages.push_back(&indexPages[pid]);
+		}
+		sitemapIndexPages.push_back(&rootPages[0]);
+		rootPages[2].location = fs::path("sitemap.xml");
+		generateSitemap(publishedPages, otherPages, sitemapIndexPages, rootPages[2]);
 
 		// Save all general pages.
+		for(size_t pid = 0; pid < indexPages.size(); ++pid){
+			savePage(indexPages[pid], _settings.outputPath(), true);
+			const size_t pageCount = pid == 0 ? publishedIndexCount : (pid == publishedIndexCount ? indexPages.size() - publishedIndexCount : 0);
+			if(pageCount > 0){
+				Log::Info() << Log::Generation << " * " << (_settings.outputPath() / indexPages[pid].location);
+				Log::Info() << (pageCount > 1 ? ", " + std::to_string(pageCount) + " pages." : ".") << std::endl;
+			}
+		}
 		for(const auto & index : rootPages){
 			savePage(index, _settings.outputPath(), true);
 			Log::Info() << Log::Generation << " * " << (_settings.outputPath() / index.location) << "." << std::endl;
 		}
+		if(indexSearch){
+			generateSearchIndex(searchIndex);
+		}
 	}
 	
 	if(mode & RESOURCES){
 		Log::Info() << Log::Generation << "Copying resources... ";
 		// force if needed
 		const auto resources = System::listItems(_settings.resourcesPath(), false, true);
+		std::vector<std::pair<fs::path, fs::path>> items;
 		for(const auto & file : resources){
-			const fs::path dstPath = _settings.outputPath() / file.filename();
-			// Copy item.
-			System::copyItem(file, dstPath, force);
+			items.emplace_back(file, _settings.outputPath() / file.filename());
 		}
-		Log::Info() << "done." << std::endl;
+		const size_t count = _copier.copy(items, force);
+		Log::Info() << count << " files updated." << std::endl;
 	}
-	
+
+	if(_settings.compressionLevel() > 0){
+		compressOutput();
+	}
+
+	// Snippets refer to this run's article pages.
+	_snippets.clear();
+
+	_manifest.save();
+	_sourceHashes.save();
+}
+
+fs::path Generator::articleLocation(const Article & article){
+	const std::string baseDir = article.type() == Article::Public ? "articles" : "drafts";
+	fs::path location = fs::path(baseDir) / article.url();
+	location.replace_extension("html");
+	return location;
 }
 
-void Generator::renderArticlePage(const Article & article, Generator::PageArticle & page, const Categories& categories){
+std::vector<std::vector<size_t>> Generator::relatedArticles(){
+	// Signatures only change with the title, content and keywords of an article.
+	const fs::path cacheFile = _settings.cachePath() / "signatures";
+	std::unordered_map<uint64_t, MinHash::Signature> cache;
+	if(System::isFile(cacheFile)){
+		std::stringstream input(System::loadStringFromFile(cacheFile));
+		std::string line;
+		while(std::getline(input, line)){
+			std::stringstream values(line);
+			uint64_t key = 0;
+			MinHash::Signature signature;
+			values >> std::hex >> key;
+			for(uint32_t & value : signature){
+				values >> value;
+			}
+			if(values){
+				cache[key] = signature;
+			}
+		}
+	}
+
+	const size_t count = _articles->size();
+	std::vector<uint64_t> keys(count);
+	std::vector<MinHash::Signature> signatures(count);
+	std::vector<bool> candidates(count);
+	std::vector<size_t> missing;
+	for(size_t aid = 0; aid < count; ++aid){
+		const Article & article = (*_articles)[aid];
+		std::string key = std::to_string(MinHash::version) + "\n" + article.title() + "\n" + article.content();
+		for(const Article::Keyword & keyword : article.keywords()){
+			key += "\n" + keyword.id;
+		}
+		keys[aid] = TextUtilities::hash(key);
+		candidates[aid] = article.type() == Article::Public;
+		const auto cached = cache.find(keys[aid]);
+		if(cached != cache.end()){
+			signatures[aid] = cached->second;
+		} else {
+			missing.push_back(aid);
+		}
+	}
+	System::forEachParallel(missing.size(), [this, &missing, &signatures](size_t mid){
+		const Article & article = (*_articles)[missing[mid]];
+		std::vector<std::string> tags;
+		for(const Article::Keyword & keyword : article.keywords()){
+			tags.push_back(keyword.id);
+		}
+		signatures[missing[mid]] = MinHash::signature(article.title() + "\n" + article.content(), tags);
+	});
+
+	// Only keep the signatures of current articles.
+	if(!missing.empty() || cache.size() != count){
+		std::stringstream output;
+		output << std::hex;
+		std::unordered_set<uint64_t> written;
+		for(size_t aid = 0; aid < count; ++aid){
+			if(!written.insert(keys[aid]).second){
+				continue;
+			}
+			output << keys[aid];
+			for(const uint32_t value : signatures[aid]){
+				output << " " << value;
+			}
+			output << "\n";
+		}
+		System::createDirectory(cacheFile.parent_path());
+		System::writeStringToFile(output.str(), cacheFile);
+	}
+
+	return MinHash::nearest(signatures, candidates, _settings.relatedCount());
+}
+
+void Generator::renderArticlePage(const Article & article, Generator::PageArticle & page, const Categories& categories, const std::vector<size_t>& related){
 	page.article = &article;
 
 	const bool isPublic = article.type() == Article::Public;
 	const std::string baseDir = isPublic ? "articles" : "drafts";
 	const fs::path baseDirPath(baseDir);
 	const fs::path sharedUrl = baseDirPath / article.url();
-	page.location = sharedUrl;
-	page.location.replace_extension("html");
+	page.location = articleLocation(article);
 
 	const std::string content = renderContent(article);
 	page.summary = TextUtilities::summarize(content, _settings.summaryLength() );
 	page.innerContent = content;
 	page.tableOfContent = renderTableOfContent(article);
 
+	const std::string relativeToRoot = "../../../";
+	// Files of published articles can be shared in the media directory.
+	const bool useMediaStore = isPublic && _settings.mediaStore();
+
 	// Look for local links.
 	page.files.clear();
+	page.variants.clear();
+	page.optimizedImages.clear();
+	std::unordered_set<std::string> resizedLinks;
 	std::string::size_type srcPos = content.find("src=\"");
 	std::string::size_type endPos = std::string::npos;
 	
@@ -304,14 +521,84 @@ void Generator::renderArticlePage(const Article & article, Generator::PageArticl
 		}
 		if(!TextUtilities::hasPrefix(link, "http") && !TextUtilities::hasPrefix(link, "www.")){
 			const fs::path srcPath = _settings.articlesPath() / link;
-			const fs::path relPath = sharedUrl.stem() / srcPath.filename();
-			const fs::path dstPath = sharedUrl / srcPath.filename();
-			page.files.push_back({srcPath, dstPath});
-			TextUtilities::replace(page.innerContent, srcLink, relPath.generic_string());
+			// Small images are embedded in the page, unless they are also linked.
+			const std::string mimeType = imageMimeType(srcPath);
+			if(_settings.inlineImageSize() > 0 && !mimeType.empty() && page.innerContent.find("href=\"" + srcLink + "\"") == std::string::npos){
+				std::error_code ec;
+				const uintmax_t size = fs::file_size(srcPath, ec);
+				std::ifstream file(System::widen(srcPath.string()), std::ios::in | std::ios::binary);
+				if(!ec && size <= _settings.inlineImageSize() && file.is_open()){
+					std::stringstream buffer;
+					buffer << file.rdbuf();
+					TextUtilities::replace(page.innerContent, "src=\"" + srcLink + "\"", "src=\"" + TextUtilities::dataUri(buffer.str(), mimeType) + "\"");
+					srcPos = content.find("src=\"", endPos);
+					continue;
+				}
+			}
+			std::string newLink;
+			fs::path dstPath;
+			if(useMediaStore && System::isFile(srcPath)){
+				std::stringstream name;
+				name << std::hex << std::setw(16) << std::setfill('0') << sourceHash(srcPath);
+				name << TextUtilities::lowercase(srcPath.extension().string());
+				dstPath = fs::path("media") / name.str();
+				newLink = relativeToRoot + dstPath.generic_string();
+			} else {
+				dstPath = sharedUrl / srcPath.filename();
+				newLink = (sharedUrl.stem() / srcPath.filename()).generic_string();
+			}
+			// Optimized images are copied from the cache.
+			fs::path copyPath = srcPath;
+			if(_settings.optimizeImages() && Image::supported(srcPath) && System::isFile(srcPath)){
+				std::stringstream name;
+				name << std::hex << std::setw(16) << std::setfill('0') << sourceHash(srcPath);
+				name << TextUtilities::lowercase(srcPath.extension().string());
+				copyPath = _settings.cachePath() / "images" / name.str();
+				page.optimizedImages.push_back({srcPath, copyPath});
+			}
+			page.files.push_back({copyPath, dstPath});
+			TextUtilities::replace(page.innerContent, srcLink, newLink);
+
+			// Let browsers pick a downscaled copy of the image.
+			int imgWidth = 0;
+			int imgHeight = 0;
+			if(!_settings.responsiveWidths().empty() && Image::supported(srcPath) && resizedLinks.count(newLink) == 0 && Image::probeSize(srcPath, imgWidth, imgHeight)){
+				resizedLinks.insert(newLink);
+				const uint64_t hash = sourceHash(srcPath);
+				std::string srcset;
+				for(const unsigned int width : _settings.responsiveWidths()){
+					if(int(width) >= imgWidth){
+						break;
+					}
+					const std::string suffix = "-" + std::to_string(width) + "w" + dstPath.extension().string();
+					page.variants.emplace_back();
+					ImageVariant & variant = page.variants.back();
+					variant.src = srcPath;
+					variant.dst = dstPath.parent_path() / (dstPath.stem().string() + suffix);
+					variant.width = width;
+					variant.hash = hash;
+					const std::string variantLink = newLink.substr(0, newLink.size() - dstPath.filename().string().size()) + variant.dst.filename().generic_string();
+					srcset += variantLink + " " + std::to_string(width) + "w, ";
+				}
+				if(!srcset.empty()){
+					srcset += newLink + " " + std::to_string(imgWidth) + "w";
+					// Images are displayed at most at their width attribute.
+					const std::string::size_type tagEnd = content.find('>', endPos);
+					const std::string::size_type widthPos = content.find(" width=\"", endPos);
+					std::string sizes = "100vw";
+					if(widthPos < tagEnd){
+						const std::string::size_type widthEnd = content.find('"', widthPos + 8);
+						const std::string displayWidth = content.substr(widthPos + 8, widthEnd - widthPos - 8);
+						if(!displayWidth.empty() && displayWidth.find_first_not_of("0123456789") == std::string::npos){
+							sizes = "(max-width: " + displayWidth + "px) 100vw, " + displayWidth + "px";
+						}
+					}
+					TextUtilities::replace(page.innerContent, "src=\"" + newLink + "\"", "src=\"" + newLink + "\" srcset=\"" + srcset + "\" sizes=\"" + sizes + "\"");
+				}
+			}
 		}
 		srcPos = content.find("src=\"", endPos);
 	}
-	const std::string relativeToRoot = "../../../";
 
 	//Prepare keywords string.
 	std::string keywordsStr;
@@ -336,6 +623,19 @@ void Generator::renderArticlePage(const Article & article, Generator::PageArticl
 		}
 	}
 
+	// Prepare related articles list.
+	std::string relatedStr;
+	if(!related.empty()){
+		relatedStr = "<ul class=\"related\">";
+		for(const size_t aid : related){
+			const Article& other = (*_articles)[aid];
+			relatedStr.append("<li><a href=\"" + relativeToRoot + articleLocation(other).generic_string() + "\">");
+			relatedStr.append(other.title());
+			relatedStr.append("</a></li>");
+		}
+		relatedStr.append("</ul>");
+	}
+
 	std::string dateLinkStr = article.dateStr();
 	if(_settings.calendarIndexPages()){
 		const std::string relativeToYear = "../";
@@ -349,6 +649,7 @@ void Generator::renderArticlePage(const Article & article, Generator::PageArticl
 	TextUtilities::replace(html, "{#DATE_LINK}", dateLinkStr);
 	TextUtilities::replace(html, "{#AUTHOR}", article.author());
 	TextUtilities::replace(html, "{#KEYWORDS}", keywordsStr);
+	TextUtilities::replace(html, "{#RELATED}", relatedStr);
 	TextUtilities::replace(html, "{#BLOG_TITLE}", _settings.blogTitle());
 	TextUtilities::replace(html, "{#LINK}", page.location.generic_string());
 	TextUtilities::replace(html, "{#SUMMARY}", page.summary);
@@ -382,17 +683,36 @@ void Generator::renderArticlePage(const Article & article, Generator::PageArticl
 	
 }
 
-std::string Generator::populateSnippet(const Generator::PageArticle & page, const fs::path& path, const std::string& src){
-	const Article& article = *page.article;
+void Generator::populateSnippet(const Generator::PageArticle & page, const fs::path& path, const std::string& src, uint64_t srcHash, std::string& html){
+	std::vector<std::string>& parts = _snippets[srcHash][&page];
+	if(parts.empty()){
+		const Article& article = *page.article;
+		// Only the link depends on the listing location, keep it as a slot between parts.
+		std::string::size_type start = 0;
+		while(true){
+			const std::string::size_type end = src.find("{#LINK}", start);
+			parts.push_back(src.substr(start, end == std::string::npos ? std::string::npos : end - start));
+			if(end == std::string::npos){
+				break;
+			}
+			start = end + 7;
+		}
+		for(std::string& part : parts){
+			TextUtilities::replace(part, "{#TITLE}", article.title());
+			TextUtilities::replace(part, "{#DATE}", article.dateStr());
+			TextUtilities::replace(part, "{#AUTHOR}", article.author());
+			TextUtilities::replace(part, "{#SUMMARY}", page.summary);
+		}
+	}
 
-	std::string html(src);
-	TextUtilities::replace(html, "{#TITLE}", article.title());
-	TextUtilities::replace(html, "{#DATE}", article.dateStr());
-	TextUtilities::replace(html, "{#AUTHOR}", article.author());
-	const fs::path finalPath = (path / page.location);
-	TextUtilities::replace(html, "{#LINK}", finalPath.generic_string());
-	TextUtilities::replace(html, "{#SUMMARY}", page.summary);
-	return html;
+	html.append(parts[0]);
+	if(parts.size() > 1){
+		const std::string finalPath = (path / page.location).generic_string();
+		for(size_t pid = 1; pid < parts.size(); ++pid){
+			html.append(finalPath);
+			html.append(parts[pid]);
+		}
+	}
 }
 
 std::string Generator::renderContentInternal(const Article & article, hoedown_renderer* renderer){
@@ -426,12 +746,50 @@ std::string Generator::renderContent(const Article & article){
 	// Init renderer based on options.
 	// Treat image title as width.
 	hoedown_renderer* renderer = hoedown_html_renderer_new(hoedown_html_flags(0), 16, 1);
+	hoedown_html_renderer_state* state = static_cast<hoedown_html_renderer_state*>(renderer->opaque);
+	state->opaque = this;
+	if(_settings.imageSizes()){
+		state->image_size = &Generator::imageSize;
+	}
+	if(_settings.highlightCode()){
+		state->highlight = &Generator::highlightCode;
+	}
 	// Interpret settings for the renderer.
 	const std::string content = renderContentInternal(article, renderer);
 	hoedown_html_renderer_free(renderer);
 	return content;
 }
 
+int Generator::imageSize(void* opaque, const uint8_t* link, size_t linkSize, int* width, int* height){
+	const Generator* generator = static_cast<const Generator*>(opaque);
+	std::string linkStr(reinterpret_cast<const char*>(link), linkSize);
+	if(TextUtilities::hasPrefix(linkStr, "%09")){
+		linkStr = linkStr.substr(3);
+	}
+	if(linkStr.empty() || TextUtilities::hasPrefix(linkStr, "http") || TextUtilities::hasPrefix(linkStr, "www.")){
+		return 0;
+	}
+	return Image::probeSize(generator->_settings.articlesPath() / linkStr, *width, *height) ? 1 : 0;
+}
+
+int Generator::highlightCode(void* opaque, hoedown_buffer* ob, const uint8_t* code, size_t codeSize, const uint8_t* lang, size_t langSize){
+	Generator* generator = static_cast<Generator*>(opaque);
+	const std::string codeStr(reinterpret_cast<const char*>(code), codeSize);
+	const std::string langStr(reinterpret_cast<const char*>(lang), langSize);
+	// Blocks are often repeated between articles and drafts.
+	const uint64_t hash = TextUtilities::hash(langStr + '\0' + codeStr);
+	auto cached = generator->_highlightedCode.find(hash);
+	if(cached == generator->_highlightedCode.end()){
+		std::string html;
+		if(!Highlighter::highlight(codeStr, langStr, html)){
+			return 0;
+		}
+		cached = generator->_highlightedCode.emplace(hash, html).first;
+	}
+	hoedown_buffer_put(ob, reinterpret_cast<const uint8_t*>(cached->second.data()), cached->second.size());
+	return 1;
+}
+
 std::string Generator::renderTableOfContent(const Article & article){
 	// Init renderer based on options.
 	// Use only two nesting levels in ToC.
@@ -442,15 +800,21 @@ std::string Generator::renderTableOfContent(const Article & article){
 	return toc;
 }
 
-bool Generator::savePage(const Page & page, const fs::path & outputDir, bool force) const {
+bool Generator::savePage(const Page & page, const fs::path & outputDir, bool force){
 	const fs::path outputFile = outputDir / page.location;
 	System::createDirectory(outputFile.parent_path(), false);
+
+	std::string minifiedHtml;
+	if(_settings.minifyPages()){
+		minifiedHtml = page.location.extension() == ".xml" ? Minifier::xml(page.html) : Minifier::html(page.html);
+	}
+	const std::string & html = _settings.minifyPages() ? minifiedHtml : page.html;
 	
 	const bool fileExists = System::itemExists(outputFile);
 	bool fileHasChanged = true;
 	// If the file already exists, maybe its content hasn't changed.
 	if(fileExists){
-		const uint64_t newHash = TextUtilities::hash(page.html);
+		const uint64_t newHash = TextUtilities::hash(html);
 		// TODO: cache old hashes in a list on disk if too slow.
 		const uint64_t oldHash = TextUtilities::hash(System::loadStringFromFile(outputFile));
 		fileHasChanged = newHash != oldHash;
@@ -458,20 +822,469 @@ bool Generator::savePage(const Page & page, const fs::path & outputDir, bool for
 
 	bool wrote = false;
 	if(force || fileHasChanged){
-		wrote = System::writeStringToFile(page.html, outputFile);
+		wrote = System::writeStringToFile(html, outputFile);
 	}
 	// Also copy related data.
 	if(!page.files.empty()){
 		// Assume they all go in the same directory.
 	   const fs::path dirPath = (outputDir / page.files.front().second).parent_path();
-	   System::createDirectory(dirPath, force);
+	   // The shared media directory is never cleared, it is pruned once all pages are saved.
+	   if(dirPath != outputDir / "media"){
+		   System::createDirectory(dirPath, force);
+	   }
+	   std::vector<std::pair<fs::path, fs::path>> items;
 	   for(const auto & file : page.files){
-		   System::copyItem(file.first, outputDir / file.second, force);
+		   items.emplace_back(file.first, outputDir / file.second);
+	   }
+	   _copier.copy(items, force);
+	   if(_listener){
+		   for(const auto & file : page.files){
+			   _listener(file.second, false);
+		   }
 	   }
 	}
+	// Notify once the page and its files are on disk.
+	if(wrote && _listener){
+		_listener(page.location, true);
+	}
 	return wrote;
 }
 
+uint64_t Generator::sourceHash(const fs::path & path){
+	const std::string key = fs::absolute(path).lexically_normal().generic_string();
+	std::error_code ec;
+	const uint64_t size = uint64_t(fs::file_size(path, ec));
+	const int64_t time = Manifest::modificationTime(path);
+	Manifest::Entry entry;
+	if(_sourceHashes.get(key, entry) && entry.size == size && entry.srcTime == time){
+		return entry.hash;
+	}
+	entry.size = size;
+	entry.srcTime = time;
+	entry.hash = System::hashFile(path);
+	_sourceHashes.set(key, entry);
+	return entry.hash;
+}
+
+void Generator::pruneMedia(const std::vector<const PageArticle*>& pages){
+	const fs::path mediaDir = _settings.outputPath() / "media";
+	if(!System::itemExists(mediaDir)){
+		return;
+	}
+	// Remove media files that no published article references anymore.
+	std::unordered_set<std::string> usedFiles;
+	for(const PageArticle* page : pages){
+		for(const auto & file : page->files){
+			usedFiles.insert(file.second.generic_string());
+		}
+		for(const ImageVariant & variant : page->variants){
+			usedFiles.insert(variant.dst.generic_string());
+		}
+	}
+	for(const fs::path & file : System::listItems(mediaDir, false, false)){
+		const std::string relPath = file.lexically_relative(_settings.outputPath()).generic_string();
+		if(usedFiles.count(relPath) == 0){
+			System::removeItem(file);
+			_manifest.remove(relPath);
+		}
+	}
+}
+
+void Generator::generateImageVariants(const std::vector<const PageArticle*>& pages){
+	// Group variants by source image, so that each is decoded once.
+	std::unordered_map<std::string, std::vector<const ImageVariant*>> variantsPerSource;
+	std::unordered_set<std::string> seen;
+	for(const PageArticle* page : pages){
+		for(const ImageVariant & variant : page->variants){
+			const std::string key = variant.dst.generic_string();
+			if(!seen.insert(key).second){
+				continue;
+			}
+			// The manifest records the source each copy was generated from.
+			const fs::path dstFile = _settings.outputPath() / variant.dst;
+			Manifest::Entry entry;
+			if(System::itemExists(dstFile) && _manifest.get(key, entry) && entry.hash == variant.hash && entry.dstTime == Manifest::modificationTime(dstFile)){
+				continue;
+			}
+			variantsPerSource[variant.src.string()].push_back(&variant);
+		}
+	}
+	if(variantsPerSource.empty()){
+		return;
+	}
+	std::vector<std::vector<const ImageVariant*>> jobs;
+	for(auto & source : variantsPerSource){
+		jobs.push_back(std::move(source.second));
+	}
+
+	std::vector<std::vector<char>> written(jobs.size());
+	const int quality = _settings.responsiveQuality();
+	System::forEachParallel(jobs.size(), [this, &jobs, &written, quality](size_t i){
+		const std::vector<const ImageVariant*> & variants = jobs[i];
+		written[i].resize(variants.size(), 0);
+		Image image;
+		if(!image.load(variants[0]->src)){
+			Log::Warning() << Log::Generation << "Unable to decode image " << variants[0]->src << ", it won't be resized." << std::endl;
+			return;
+		}
+		std::error_code ec;
+		const uint64_t srcSize = uint64_t(fs::file_size(variants[0]->src, ec));
+		const int64_t srcTime = Manifest::modificationTime(variants[0]->src);
+		for(size_t vid = 0; vid < variants.size(); ++vid){
+			const ImageVariant & variant = *variants[vid];
+			const fs::path dstFile = _settings.outputPath() / variant.dst;
+			// Write to a hidden file first, so that an interrupted generation never leaves a truncated copy.
+			const fs::path tempFile = dstFile.parent_path() / ("." + dstFile.stem().string() + ".thoth" + dstFile.extension().string());
+			System::createDirectory(dstFile.parent_path());
+			if(!image.resized(variant.width).save(tempFile, quality)){
+				Log::Error() << Log::Generation << "Unable to write " << dstFile << "." << std::endl;
+				System::removeItem(tempFile);
+				continue;
+			}
+			fs::rename(tempFile, dstFile, ec);
+			if(ec){
+				Log::Error() << Log::Generation << "Unable to write " << dstFile << "." << std::endl;
+				System::removeItem(tempFile);
+				continue;
+			}
+			_manifest.set(variant.dst.generic_string(), { srcSize, srcTime, Manifest::modificationTime(dstFile), variant.hash });
+			written[i][vid] = 1;
+		}
+	});
+
+	size_t count = 0;
+	for(size_t i = 0; i < jobs.size(); ++i){
+		for(size_t vid = 0; vid < written[i].size(); ++vid){
+			if(!written[i][vid]){
+				continue;
+			}
+			++count;
+			if(_listener){
+				_listener(jobs[i][vid]->dst, true);
+			}
+		}
+	}
+	Log::Info() << Log::Generation << "Generated " << count << " downscaled images." << std::endl;
+}
+
+void Generator::optimizeImages(const std::vector<const PageArticle*>& pages){
+	// Each version of an image is stored once, named after its content.
+	std::vector<std::pair<fs::path, fs::path>> jobs;
+	std::unordered_set<std::string> seen;
+	for(const PageArticle* page : pages){
+		for(const auto & image : page->optimizedImages){
+			if(seen.insert(image.second.generic_string()).second && !System::itemExists(image.second)){
+				jobs.push_back(image);
+			}
+		}
+	}
+	if(jobs.empty()){
+		return;
+	}
+	System::createDirectory(_settings.cachePath() / "images");
+	std::vector<char> written(jobs.size(), 0);
+	System::forEachParallel(jobs.size(), [&jobs, &written](size_t i){
+		const fs::path & dstFile = jobs[i].second;
+		// Write to a hidden file first, so that an interrupted generation never leaves a truncated image in the cache.
+		const fs::path tempFile = dstFile.parent_path() / ("." + dstFile.filename().string() + ".thoth");
+		std::error_code ec;
+		if(Image::optimize(jobs[i].first, tempFile)){
+			fs::rename(tempFile, dstFile, ec);
+		}
+		if(ec || !System::itemExists(dstFile)){
+			Log::Error() << Log::Generation << "Unable to write optimized image " << dstFile << "." << std::endl;
+			System::removeItem(tempFile);
+			return;
+		}
+		written[i] = 1;
+	});
+	const size_t count = size_t(std::count(written.begin(), written.end(), char(1)));
+	Log::Info() << Log::Generation << "Optimized " << count << " images." << std::endl;
+}
+
+void Generator::pruneImageCache(const std::vector<PageArticle>& pages){
+	const fs::path cacheDir = _settings.cachePath() / "images";
+	if(!System::itemExists(cacheDir)){
+		return;
+	}
+	std::unordered_set<std::string> usedFiles;
+	for(const PageArticle & page : pages){
+		for(const auto & image : page.optimizedImages){
+			usedFiles.insert(image.second.filename().string());
+		}
+	}
+	for(const fs::path & file : System::listItems(cacheDir, false, false)){
+		if(usedFiles.count(file.filename().string()) == 0){
+			System::removeItem(file);
+		}
+	}
+}
+
+void Generator::inlineCriticalStyles(){
+	// Article elements usually visible when the page is first displayed.
+	const std::string articleContent = "<p><a><em><strong><code><img><figure><h2><h3><ul><ol><li><blockquote><br>";
+	std::string articleMarkup = _template.article;
+	TextUtilities::replace(articleMarkup, "{#CONTENT}", articleContent);
+	const std::string indexMarkup = _template.header + _template.indexItem + _template.footer;
+	const std::string categoryMarkup = _template.headerCategory + _template.itemHeaderCategory + _template.itemArticleCategory + _template.itemFooterCategory + _template.footerCategory;
+
+	const auto attributeValue = [](const std::string & tag, const std::string & name){
+		const std::string::size_type pos = tag.find(" " + name + "=");
+		if(pos == std::string::npos){
+			return std::string();
+		}
+		std::string::size_type start = pos + name.size() + 2;
+		std::string::size_type end;
+		if(start < tag.size() && (tag[start] == '"' || tag[start] == '\'')){
+			end = tag.find(tag[start], start + 1);
+			++start;
+		} else {
+			end = tag.find_first_of(" \t\n/>", start);
+		}
+		return tag.substr(start, end == std::string::npos ? std::string::npos : end - start);
+	};
+
+	const std::vector<std::pair<std::string*, const std::string*>> pages = { { &_template.article, &articleMarkup }, { &_template.header, &indexMarkup }, { &_template.headerCategory, &categoryMarkup } };
+	for(const auto & page : pages){
+		std::string & html = *page.first;
+		std::string::size_type pos = html.find("<link");
+		while(pos != std::string::npos){
+			const std::string::size_type end = html.find('>', pos);
+			if(end == std::string::npos){
+				break;
+			}
+			const std::string tag = html.substr(pos, end - pos + 1);
+			const std::string href = attributeValue(tag, "href");
+			if(TextUtilities::lowercase(attributeValue(tag, "rel")) != "stylesheet" || href.empty() || href.find("//") != std::string::npos){
+				pos = html.find("<link", end);
+				continue;
+			}
+			// Stylesheets are in the output directory, at the same relative location as in the template.
+			std::string relPath = href.substr(0, href.find_first_of("?#"));
+			while(TextUtilities::hasPrefix(relPath, "../") || TextUtilities::hasPrefix(relPath, "./") || TextUtilities::hasPrefix(relPath, "/")){
+				relPath = relPath.substr(relPath.find('/') + 1);
+			}
+			const fs::path cssFile = _settings.outputPath() / relPath;
+			if(!System::isFile(cssFile)){
+				pos = html.find("<link", end);
+				continue;
+			}
+			// Relative URLs of the stylesheet are resolved from its directory.
+			const std::string::size_type dirEnd = href.find_last_of('/', href.find_first_of("?#"));
+			const std::string base = dirEnd == std::string::npos ? "" : href.substr(0, dirEnd + 1);
+			// Extracted rules only change with the stylesheet, its location and the template.
+			const std::string css = System::loadStringFromFile(cssFile);
+			std::stringstream name;
+			name << std::hex << std::setw(16) << std::setfill('0') << TextUtilities::hash(css + *page.second + base) << ".css";
+			const fs::path cacheFile = _settings.cachePath() / "styles" / name.str();
+			std::string critical;
+			if(System::isFile(cacheFile)){
+				critical = System::loadStringFromFile(cacheFile);
+			} else {
+				critical = CriticalStyles::extract(css, *page.second, base);
+				System::createDirectory(cacheFile.parent_path());
+				System::writeStringToFile(critical, cacheFile);
+			}
+
+			const std::string media = attributeValue(tag, "media");
+			std::string deferredTag = tag;
+			const std::string::size_type relPos = deferredTag.find(" rel=");
+			const std::string::size_type relEnd = deferredTag.find_first_of(" >", relPos + 1);
+			deferredTag.replace(relPos, relEnd - relPos, " rel=\"preload\" as=\"style\" onload=\"this.onload=null;this.rel='stylesheet'\"");
+			std::string replacement = "<style" + (media.empty() ? "" : " media=\"" + media + "\"") + ">" + critical + "</style>";
+			replacement += deferredTag + "<noscript>" + tag + "</noscript>";
+			html.replace(pos, tag.size(), replacement);
+			pos = html.find("<link", pos + replacement.size());
+		}
+	}
+}
+
+void Generator::fingerprintAssets(const std::vector<fs::path> & files){
+	std::vector<std::pair<std::string, std::string>> renamed;
+	for(const fs::path & file : files){
+		if(!isFingerprintedAsset(file)){
+			continue;
+		}
+		const std::string ext = TextUtilities::lowercase(file.extension().string());
+		const std::string content = System::loadStringFromFile(file);
+		const std::string minified = ext == ".css" ? Minifier::css(content) : Minifier::js(content);
+		std::stringstream hash;
+		hash << std::hex << std::setw(8) << std::setfill('0') << (TextUtilities::hash(minified) & 0xFFFFFFFFu);
+		const fs::path relPath = file.lexically_relative(_settings.templatePath());
+		const fs::path dstPath = relPath.parent_path() / (file.stem().string() + "." + hash.str() + ext);
+		const fs::path outputFile = _settings.outputPath() / dstPath;
+		// The name changes with the content, an existing file is up to date.
+		if(!System::itemExists(outputFile)){
+			System::createDirectory(outputFile.parent_path());
+			System::writeStringToFile(minified, outputFile);
+		}
+		renamed.emplace_back(relPath.generic_string(), dstPath.generic_string());
+
+		// Remove the original and previous versions.
+		System::removeItem(_settings.outputPath() / relPath);
+		const std::string prefix = file.stem().string() + ".";
+		for(const fs::path & existing : System::listItems(outputFile.parent_path(), false, false)){
+			const std::string name = existing.filename().string();
+			if(existing != outputFile && name.size() == prefix.size() + 8 + ext.size() && TextUtilities::hasPrefix(name, prefix) && TextUtilities::hasSuffix(name, ext)
+			   && name.find_first_not_of("0123456789abcdef", prefix.size()) == prefix.size() + 8){
+				System::removeItem(existing);
+			}
+		}
+	}
+
+	// Update references, only matching the complete relative path at the start of a quoted attribute value,
+	// after parent directories or the relative root link. Absolute URLs never match.
+	const std::string rootLink = "{#RELATIVE_ROOT_LINK}/";
+	const std::string after = "\"'?#";
+	const auto startsValue = [&rootLink](const std::string & html, std::string::size_type pos){
+		if(pos >= rootLink.size() && html.compare(pos - rootLink.size(), rootLink.size(), rootLink) == 0){
+			return true;
+		}
+		while(true){
+			if(pos >= 3 && html.compare(pos - 3, 3, "../") == 0){
+				pos -= 3;
+			} else if(pos >= 2 && html.compare(pos - 2, 2, "./") == 0){
+				pos -= 2;
+			} else {
+				break;
+			}
+		}
+		return pos > 0 && (html[pos - 1] == '"' || html[pos - 1] == '\'');
+	};
+	const auto rewrite = [&renamed, &after, &startsValue](std::string & html){
+		for(const auto & names : renamed){
+			std::string::size_type pos = html.find(names.first);
+			while(pos != std::string::npos){
+				const std::string::size_type end = pos + names.first.size();
+				const bool startOk = startsValue(html, pos);
+				const bool endOk = end == html.size() || after.find(html[end]) != std::string::npos;
+				if(startOk && endOk){
+					html.replace(pos, names.first.size(), names.second);
+					pos = html.find(names.first, pos + names.second.size());
+				} else {
+					pos = html.find(names.first, end);
+				}
+			}
+		}
+	};
+	for(std::string * html : { &_template.article, &_template.header, &_template.footer, &_template.indexItem,
+		 &_template.headerCategory, &_template.footerCategory, &_template.itemHeaderCategory, &_template.itemFooterCategory, &_template.itemArticleCategory }){
+		rewrite(*html);
+	}
+	for(auto & snippet : _template.overrides){
+		rewrite(snippet.second);
+	}
+}
+
+void Generator::indexArticles(const std::vector<const PageArticle*>& pages, SearchIndex& index){
+	std::vector<SearchIndex::Document> documents(pages.size());
+	for(size_t pid = 0; pid < pages.size(); ++pid){
+		const Article & article = *pages[pid]->article;
+		SearchIndex::Document & document = documents[pid];
+		document.title = article.title();
+		document.url = pages[pid]->location.generic_string();
+		for(const Article::Keyword & keyword : article.keywords()){
+			document.keywords += keyword.name + " ";
+		}
+		document.html = pages[pid]->innerContent;
+	}
+	index.add(documents);
+}
+
+void Generator::generateSearchIndex(const SearchIndex& index){
+	const auto files = index.files();
+
+	const fs::path searchDir = _settings.outputPath() / "search";
+	System::createDirectory(searchDir);
+	std::unordered_set<std::string> names;
+	size_t count = 0;
+	for(const auto & file : files){
+		names.insert(file.first);
+		const fs::path path = searchDir / file.first;
+		if(System::itemExists(path) && System::hashFile(path) == TextUtilities::hash(file.second)){
+			continue;
+		}
+		std::ofstream stream(System::widen(path.string()), std::ios::out | std::ios::binary | std::ios::trunc);
+		stream.write(file.second.data(), std::streamsize(file.second.size()));
+		if(!stream){
+			Log::Error() << Log::Generation << "Unable to write " << path << "." << std::endl;
+			continue;
+		}
+		++count;
+		if(_listener){
+			_listener(path.lexically_relative(_settings.outputPath()), true);
+		}
+	}
+	// Remove shards of terms that don't appear anymore.
+	for(const fs::path & file : System::listItems(searchDir, false, false)){
+		if(names.count(file.filename().string()) == 0){
+			System::removeItem(file);
+		}
+	}
+	Log::Info() << Log::Generation << " * " << searchDir << ", " << count << " of " << files.size() << " files updated." << std::endl;
+}
+
+void Generator::compressOutput(){
+	const std::unordered_set<std::string> textExtensions = { ".html", ".xml", ".css", ".js", ".svg", ".json", ".txt" };
+	std::vector<fs::path> files;
+	for(const fs::path & file : System::listItems(_settings.outputPath(), true, false)){
+		if(textExtensions.count(TextUtilities::lowercase(file.extension().string())) != 0){
+			files.push_back(file);
+		} else if(file.extension() == ".gz" && textExtensions.count(TextUtilities::lowercase(file.stem().extension().string())) != 0){
+			// Remove compressed copies of deleted files.
+			fs::path srcFile = file;
+			srcFile.replace_extension();
+			if(!System::itemExists(srcFile)){
+				System::removeItem(file);
+				_manifest.remove(file.lexically_relative(_settings.outputPath()).generic_string());
+			}
+		}
+	}
+
+	std::vector<char> written(files.size(), 0);
+	const int level = _settings.compressionLevel();
+	System::forEachParallel(files.size(), [this, &files, &written, level](size_t i){
+		const fs::path & file = files[i];
+		const fs::path compressedFile = file.string() + ".gz";
+		// The compressed file is recorded with the size, time and hash of its source.
+		const std::string key = compressedFile.lexically_relative(_settings.outputPath()).generic_string();
+		std::error_code ec;
+		const uint64_t size = uint64_t(fs::file_size(file, ec));
+		const int64_t time = Manifest::modificationTime(file);
+		Manifest::Entry entry;
+		uint64_t hash = 0;
+		if(System::itemExists(compressedFile) && _manifest.get(key, entry) && entry.size == size && entry.dstTime == Manifest::modificationTime(compressedFile)){
+			if(entry.srcTime == time){
+				return;
+			}
+			hash = System::hashFile(file);
+			if(hash == entry.hash){
+				entry.srcTime = time;
+				_manifest.set(key, entry);
+				return;
+			}
+		}
+		if(!System::gzipFile(file, compressedFile, level)){
+			Log::Error() << Log::Generation << "Unable to compress " << file << "." << std::endl;
+			return;
+		}
+		_manifest.set(key, { size, time, Manifest::modificationTime(compressedFile), hash != 0 ? hash : System::hashFile(file) });
+		written[i] = 1;
+	});
+
+	size_t count = 0;
+	for(size_t i = 0; i < files.size(); ++i){
+		if(!written[i]){
+			continue;
+		}
+		++count;
+		if(_listener){
+			_listener(fs::path(files[i].string() + ".gz").lexically_relative(_settings.outputPath()), true);
+		}
+	}
+	Log::Info() << Log::Generation << "Compressed " << count << " files." << std::endl;
+}
+
 size_t Generator::saveArticlePages(const std::vector<const PageArticle*>& pages, const fs::path & output, bool force){
 	size_t count = 0;
 	// Save pages.
@@ -482,23 +1295,77 @@ size_t Generator::saveArticlePages(const std::vector<const PageArticle*>& pages,
 	return count;
 }
 
-void Generator::generateIndexPage(const std::vector<const PageArticle*>& pages, const std::string& title, const fs::path& relativePath, const std::string& parentPath, Generator::Page& page){
-
-	std::string html(_template.footer);
-	for(size_t aid = 0; aid < pages.size(); ++aid){
-		const PageArticle& page = *(pages[aid]);
-		const std::string content = populateSnippet(page, relativePath, _template.indexItem);
-		html.insert(html.begin(), content.begin(), content.end());
+void Generator::generateIndexPages(const std::vector<const PageArticle*>& pages, const std::string& title, const fs::path& relativePath, const std::string& parentPath, const fs::path& location, const fs::path& pagesDir, std::vector<Generator::Page>& indexPages){
+
+	const size_t pageSize = _settings.indexPageSize() > 0 ? size_t(_settings.indexPageSize()) : (std::max)(pages.size(), size_t(1));
+	const size_t pageCount = (std::max)((pages.size() + pageSize - 1) / pageSize, size_t(1));
+	// Following pages are stored in a subdirectory, for instance index.html is followed by page/2.html, other.html by page/other-2.html.
+	const std::string stem = location.stem().string();
+	const auto pageName = [&stem](size_t pid){
+		return (stem == "index" ? "" : stem + "-") + std::to_string(pid + 1) + ".html";
+	};
+	// Path back to the directory of the first page.
+	fs::path upPath;
+	for(auto it = pagesDir.begin(); it != pagesDir.end(); ++it){
+		upPath /= "..";
 	}
+	const std::string up = upPath.generic_string() + "/";
+
+	for(size_t pid = 0; pid < pageCount; ++pid){
+		const bool first = pid == 0;
+		const fs::path pageRelativePath = first ? relativePath : (relativePath == "." ? upPath : upPath / relativePath);
+		std::string pageParentPath = parentPath;
+		if(!first && !parentPath.empty() && parentPath[0] != '/' && parentPath.find("://") == std::string::npos){
+			pageParentPath = up + parentPath;
+		}
+		std::string previousLink;
+		std::string nextLink;
+		if(pid > 0){
+			const std::string link = pid == 1 ? up + location.filename().string() : pageName(pid - 1);
+			previousLink = "<a href=\"" + link + "\" class=\"previous-page\" rel=\"prev\">&larr;</a>";
+		}
+		if(pid + 1 < pageCount){
+			const std::string link = (first ? pagesDir.generic_string() + "/" : "") + pageName(pid + 1);
+			nextLink = "<a href=\"" + link + "\" class=\"next-page\" rel=\"next\">&rarr;</a>";
+		}
 
-	html.insert(html.begin(), _template.header.begin(),  _template.header.end());
-	TextUtilities::replace(html, "{#BLOG_TITLE}", title);
-	TextUtilities::replace(html, "{#AUTHOR}", _settings.defaultAuthor());
-	TextUtilities::replace(html, "{#ROOT_LINK}", _settings.siteRoot());
-	TextUtilities::replace(html, "{#RELATIVE_ROOT_LINK}", relativePath.generic_string());
-	TextUtilities::replace(html, "{#PARENT_LINK}", parentPath);
+		// Replace shared keywords once in each part of the template, the author of items is replaced by each snippet.
+		std::string header(_template.header);
+		std::string item(_template.indexItem);
+		std::string footer(_template.footer);
+		for(std::string* part : { &header, &item, &footer }){
+			TextUtilities::replace(*part, "{#BLOG_TITLE}", title);
+			TextUtilities::replace(*part, "{#ROOT_LINK}", _settings.siteRoot());
+			TextUtilities::replace(*part, "{#RELATIVE_ROOT_LINK}", pageRelativePath.generic_string());
+			TextUtilities::replace(*part, "{#PARENT_LINK}", pageParentPath);
+			TextUtilities::replace(*part, "{#PREVIOUS_PAGE}", previousLink);
+			TextUtilities::replace(*part, "{#NEXT_PAGE}", nextLink);
+		}
+		TextUtilities::replace(header, "{#AUTHOR}", _settings.defaultAuthor());
+		TextUtilities::replace(footer, "{#AUTHOR}", _settings.defaultAuthor());
+
+		// Most recent articles first, assembled in a single pass.
+		const size_t firstItem = pid * pageSize;
+		const size_t lastItem = (std::min)(firstItem + pageSize, pages.size());
+		size_t size = header.size() + footer.size();
+		for(size_t iid = firstItem; iid < lastItem; ++iid){
+			const PageArticle& page = *(pages[pages.size() - 1 - iid]);
+			size += item.size() + page.summary.size() + page.article->title().size() + 256;
+		}
 
-	page.html = html;
+		indexPages.emplace_back();
+		Page& indexPage = indexPages.back();
+		indexPage.location = first ? location : location.parent_path() / pagesDir / pageName(pid);
+		std::string& html = indexPage.html;
+		html.reserve(size);
+		html.append(header);
+		const uint64_t itemHash = TextUtilities::hash(item);
+		for(size_t iid = firstItem; iid < lastItem; ++iid){
+			const PageArticle& page = *(pages[pages.size() - 1 - iid]);
+			populateSnippet(page, pageRelativePath, item, itemHash, html);
+		}
+		html.append(footer);
+	}
 }
 
 void Generator::generateCategoriesPage(const std::unordered_map<std::string, std::vector<const PageArticle*>>& categoryArticles, const Categories& categories, const std::string& title, const fs::path& relativePath, const fs::path& parentPath, Generator::Page& page){
@@ -512,19 +1379,20 @@ void Generator::generateCategoriesPage(const std::unordered_map<std::string, std
 	std::sort(keywordIDs.begin(), keywordIDs.end());
 
 	std::string html = _template.headerCategory;
+	const uint64_t itemHash = TextUtilities::hash(_template.itemArticleCategory);
 	for(const std::string& categoryID : keywordIDs){
 
 		const std::vector<const PageArticle*>& pages = categoryArticles.at(categoryID);
 		const Category& infos = categories.at(categoryID);
 
-		std::string htmlCat(_template.itemFooterCategory);
-		for(size_t aid = 0; aid < pages.size(); ++aid){
-			const PageArticle& page = *(pages[aid]);
-			const std::string content = Generator::populateSnippet(page, relativePath, _template.itemArticleCategory);
-			htmlCat.insert(htmlCat.begin(), content.begin(), content.end());
+		// Most recent articles first, assembled in a single pass.
+		std::string htmlCat;
+		htmlCat.reserve(_template.itemHeaderCategory.size() + _template.itemFooterCategory.size() + pages.size() * (_template.itemArticleCategory.size() + 256));
+		htmlCat.append(_template.itemHeaderCategory);
+		for(auto pageIt = pages.rbegin(); pageIt != pages.rend(); ++pageIt){
+			populateSnippet(**pageIt, relativePath, _template.itemArticleCategory, itemHash, htmlCat);
 		}
-
-		htmlCat.insert(htmlCat.begin(), _template.itemHeaderCategory.begin(),  _template.itemHeaderCategory.end());
+		htmlCat.append(_template.itemFooterCategory);
 
 		TextUtilities::replace(htmlCat, "{#CATEGORY_TITLE}", infos.name);
 		TextUtilities::replace(htmlCat, "{#CATEGORY_ID}", categoryID);
@@ -2,8 +2,12 @@
 
 #include "Common.hpp"
 #include "Articles.hpp"
+#include "system/Manifest.hpp"
+#include "system/Copier.hpp"
 #include <unordered_map>
+#include <functional>
 
+class SearchIndex;
 struct hoedown_buffer;
 struct hoedown_renderer;
 
@@ -13,6 +17,8 @@ enum Mode : uint {
 	INDEX = 4,
 	RESOURCES = 8,
 	FORCE = 16,
+	SYNC = 32,
+	PLAN = 64,
 	ALL = ARTICLES | DRAFTS | INDEX | RESOURCES
 };
 
@@ -22,7 +28,8 @@ enum Action : uint {
 	GENERATE = 2,
 	UPLOAD = 4,
 	PASSWORD = 8,
-	TEST = 16
+	TEST = 16,
+	AGENT = 32
 };
 
 class Generator {
@@ -32,6 +39,11 @@ public:
 	Generator(const Settings & settings);
 	
 	void process(const std::vector<Article> & articles, uint mode);
+
+	/// Notified with the output-relative path of each page written and each file copied, and if the content is known to have changed.
+	using OutputListener = std::function<void(const fs::path&, bool)>;
+
+	void setOutputListener(const OutputListener& listener){ _listener = listener; }
 	
 	~Generator();
 	
@@ -44,6 +56,13 @@ private:
 		std::vector<std::pair<fs::path, fs::path>> files;
 	};
 
+	struct ImageVariant {
+		fs::path src; ///< Source image.
+		fs::path dst; ///< Downscaled copy, relative to the output directory.
+		unsigned int width = 0;
+		uint64_t hash = 0; ///< Content hash of the source.
+	};
+
 	struct PageArticle : public Page {
 	public:
 
@@ -52,6 +71,8 @@ private:
 		std::string innerContent;
 		std::string tableOfContent;
 		std::string summary;
+		std::vector<ImageVariant> variants;
+		std::vector<std::pair<fs::path, fs::path>> optimizedImages; ///< Source images and their optimized version in the cache.
 	};
 
 	struct Category {
@@ -75,15 +96,27 @@ private:
 
 	using Categories = std::unordered_map<std::string, Category>;
 	
-	void renderArticlePage(const Article & article, PageArticle & page, const Categories& categories);
+	void renderArticlePage(const Article & article, PageArticle & page, const Categories& categories, const std::vector<size_t>& related);
+
+	static fs::path articleLocation(const Article & article);
+
+	/// Find the published articles most similar to each article, reusing the signatures of unchanged articles from the cache.
+	std::vector<std::vector<size_t>> relatedArticles();
 
 	std::string renderContentInternal(const Article & article, hoedown_renderer* renderer);
 
 	std::string renderContent(const Article & article);
 	
 	std::string renderTableOfContent(const Article & article);
+
+	/// Renderer callback providing the dimensions of a local image.
+	static int imageSize(void* opaque, const uint8_t* link, size_t linkSize, int* width, int* height);
+
+	/// Renderer callback highlighting a fenced code block.
+	static int highlightCode(void* opaque, hoedown_buffer* ob, const uint8_t* code, size_t codeSize, const uint8_t* lang, size_t langSize);
 	
-	void generateIndexPage(const std::vector<const PageArticle*>& pages, const std::string& title, const fs::path& relativePath, const std::string& parentPath, Page& page);
+	/// Generate the index pages listing articles, split according to the settings, and append them to a list. Following pages are stored in a subdirectory next to the first one.
+	void generateIndexPages(const std::vector<const PageArticle*>& pages, const std::string& title, const fs::path& relativePath, const std::string& parentPath, const fs::path& location, const fs::path& pagesDir, std::vector<Page>& indexPages);
 
 	void generateCategoriesPage(const std::unordered_map<std::string, std::vector<const PageArticle*>>& categoryArticles, const Categories& categories, const std::string& title,  const fs::path& relativePath, const fs::path& parentPath, Generator::Page& page);
 
@@ -91,15 +124,51 @@ private:
 
 	void generateSitemap(const std::vector<const PageArticle*>& articlePages, const std::vector<Page>& otherPages, const std::vector<const Page*>& indexPages, Generator::Page& sitemap);
 	
-	bool savePage(const Page & page, const fs::path & outputDir, bool force) const;
+	bool savePage(const Page & page, const fs::path & outputDir, bool force);
+
+	/// Content hash of a source file, cached between runs.
+	uint64_t sourceHash(const fs::path & path);
+
+	void pruneMedia(const std::vector<const PageArticle*>& pages);
+
+	/// Write the downscaled copies of article images, for those that are missing or outdated.
+	void generateImageVariants(const std::vector<const PageArticle*>& pages);
+
+	/// Write the optimized versions of article images in the cache, for those that are missing.
+	void optimizeImages(const std::vector<const PageArticle*>& pages);
+
+	/// Remove optimized images that no article uses anymore from the cache.
+	void pruneImageCache(const std::vector<PageArticle>& pages);
+
+	/// Add the content of published articles to the search index.
+	void indexArticles(const std::vector<const PageArticle*>& pages, SearchIndex& index);
+
+	/// Write the search index of published articles in the output, only updating the files that changed.
+	void generateSearchIndex(const SearchIndex& index);
+
+	/// Write compressed copies of text files in the output, for those that changed.
+	void compressOutput();
+
+	/// Write minified stylesheets and scripts named after their content, and update references in the template.
+	void fingerprintAssets(const std::vector<fs::path> & files);
+
+	/// Inline the rules of template stylesheets used by each type of page, and load the complete stylesheets without blocking rendering.
+	void inlineCriticalStyles();
 	
 	size_t saveArticlePages(const std::vector<const PageArticle*>& pages, const fs::path & output, bool force);
 
-	static std::string populateSnippet(const Generator::PageArticle & page, const fs::path& path, const std::string& src);
+	/// Append the snippet of an article to a listing. Snippets are populated once for each article and template, only their links depend on the listing location.
+	void populateSnippet(const Generator::PageArticle & page, const fs::path& path, const std::string& src, uint64_t srcHash, std::string& html);
 	
 	Template _template;
 	const Settings & _settings;
-	std::vector<Article> _articles;
+	Manifest _manifest;
+	Copier _copier;
+	Manifest _sourceHashes;
+	const std::vector<Article>* _articles = nullptr; ///< Articles being processed.
+	OutputListener _listener;
+	std::unordered_map<uint64_t, std::string> _highlightedCode; ///< Highlighted code blocks, by hash of their language and content.
+	std::unordered_map<uint64_t, std::unordered_map<const PageArticle*, std::vector<std::string>>> _snippets; ///< Populated snippets split around their links, by hash of the template and article page.
 	
 	hoedown_buffer * _buffer;
 };
@@ -11,6 +11,7 @@ Settings::Settings(const fs::path & path){
 	_templatePath = _rootPath / "template";
 	_articlesPath = _rootPath / "articles";
 	_outputPath = _rootPath / "output";
+	_cachePath = _rootPath / "cache";
 	_resourcesPath = _rootPath / "resources";
 }
 
@@ -53,6 +54,8 @@ bool Settings::load(){
 				_articlesPath = value;
 			} else if(key == "outputPath"){
 				_outputPath = value;
+			} else if(key == "cachePath"){
+				_cachePath = value;
 			} else if(key == "defaultAuthor"){
 				_defaultAuthor = value;
 			} else if(key == "dateStyle"){
@@ -65,8 +68,49 @@ bool Settings::load(){
 				_imageWidth = value;
 			} else if(key == "imagesLinks"){
 				_imagesLinks = parseBool(value);
+			} else if(key == "imageSizes"){
+				_imageSizes = parseBool(value);
+			} else if(key == "responsiveWidths"){
+				_responsiveWidths.clear();
+				for(const std::string & width : TextUtilities::split(value, ",", true)){
+					const std::string widthStr = TextUtilities::trim(width, " \t");
+					if(!widthStr.empty() && std::stoi(widthStr) > 0){
+						_responsiveWidths.push_back(unsigned(std::stoi(widthStr)));
+					}
+				}
+				std::sort(_responsiveWidths.begin(), _responsiveWidths.end());
+			} else if(key == "responsiveQuality"){
+				_responsiveQuality = (std::min)((std::max)(std::stoi(value), 1), 100);
+			} else if(key == "inlineImageSize"){
+				_inlineImageSize = (unsigned int)(std::max)(std::stoi(value), 0);
+			} else if(key == "optimizeImages"){
+				_optimizeImages = parseBool(value);
+			} else if(key == "hardLinkResources"){
+				_hardLinkResources = parseBool(value);
+			} else if(key == "mediaStore"){
+				_mediaStore = parseBool(value);
+			} else if(key == "fingerprintAssets"){
+				_fingerprintAssets = parseBool(value);
+			} else if(key == "criticalStyles"){
+				_criticalStyles = parseBool(value);
+			} else if(key == "highlightCode"){
+				_highlightCode = parseBool(value);
+			} else if(key == "searchIndex"){
+				_searchIndex = parseBool(value);
+			} else if(key == "memoryBudget"){
+				_memoryBudget = (unsigned int)(std::max)(std::stoi(value), 0);
+			} else if(key == "minifyPages"){
+				_minifyPages = parseBool(value);
+			} else if(key == "compressionLevel"){
+				_compressionLevel = (std::min)((std::max)(std::stoi(value), 0), 9);
 			} else if(key == "ftpAdress"){
-				
+				// A local directory can be used as target.
+				_ftpLocal = TextUtilities::hasPrefix(value, "file://");
+				if(_ftpLocal){
+					_ftpDomain = "";
+					_ftpPath = value.substr(7);
+					continue;
+				}
 				TextUtilities::replace(value, "sftp://", "");
 				TextUtilities::replace(value, "ssh://", "");
 				TextUtilities::replace(value, "ftp://", "");
@@ -90,6 +134,8 @@ bool Settings::load(){
 				_ftpUsername = value;
 			} else if(key == "ftpPort"){
 				_ftpPort = std::stoi(value);
+			} else if(key == "ftpLinkDuplicates"){
+				_ftpLinkDuplicates = parseBool(value);
 			} else if(key == "ftpPassword"){
 				_ftpPassword = value;
 			} else if(key == "siteRoot"){
@@ -100,6 +146,10 @@ bool Settings::load(){
 				_rssCount = std::stoi(value);
 			} else if(key == "summaryLength"){
 				_summaryLength = std::stoi(value);
+			} else if(key == "indexPageSize"){
+				_indexPageSize = (unsigned int)(std::max)(std::stoi(value), 0);
+			} else if(key == "relatedCount"){
+				_relatedCount = (unsigned int)(std::max)(std::stoi(value), 0);
 			} else if(key == "calendarPages"){
 				_calendarIndexPages = parseBool(value);
 			} else if(key == "perCategoryLink"){
@@ -138,6 +188,11 @@ std::string Settings::str(bool includeHelp){
 		str << "\n# The path where Thoth should output the generated content\n#\t(defaults to rootPath/output)\n";
 	}
 	str << "outputPath" << ":\t\t" << _outputPath.string() << "\n";
+
+	if(includeHelp){
+		str << "\n# The path where Thoth should store intermediate results reused between runs, can be deleted at any time\n#\t(defaults to rootPath/cache)\n";
+	}
+	str << "cachePath" << ":\t\t" << _cachePath.string() << "\n";
 	
 	if(includeHelp){
 		str << "\n# The title of the blog\n#\t(defaults to \"A new blog\")\n";
@@ -168,12 +223,88 @@ std::string Settings::str(bool includeHelp){
 		str << "\n# Set to true if you want each image of an article to link directly to the corresponding file\n#\t(defaults to false)\n";
 	}
 	str << "imagesLinks" << ":\t\t" << (_imagesLinks ? "true" : "false") << "\n";
+
+	if(includeHelp){
+		str << "\n# Set to true if you want the dimensions of local images to be read and added to the html pages, and images below the first one to be lazily loaded\n#\t(defaults to true)\n";
+	}
+	str << "imageSizes" << ":\t\t" << (_imageSizes ? "true" : "false") << "\n";
+
+	if(includeHelp){
+		str << "\n# Comma-separated widths of downscaled copies of the PNG and JPEG images of articles, that browsers can pick from based on the screen size (for instance 480, 960, 1600)\n#\t(defaults to none)\n";
+	}
+	str << "responsiveWidths" << ":\t\t";
+	for(size_t wid = 0; wid < _responsiveWidths.size(); ++wid){
+		str << (wid != 0 ? ", " : "") << _responsiveWidths[wid];
+	}
+	str << "\n";
+
+	if(includeHelp){
+		str << "\n# JPEG quality of the downscaled copies of images, from 1 to 100\n#\t(defaults to 85)\n";
+	}
+	str << "responsiveQuality" << ":\t\t" << _responsiveQuality << "\n";
+
+	if(includeHelp){
+		str << "\n# Size in bytes under which local images of articles (PNG, JPEG, GIF, WebP, SVG) are embedded directly in the html pages instead of being copied, 0 to disable\n#\t(defaults to 0)\n";
+	}
+	str << "inlineImageSize" << ":\t\t" << _inlineImageSize << "\n";
+
+	if(includeHelp){
+		str << "\n# Set to true if you want the PNG and JPEG images of articles to be made smaller without changing their pixels, by removing metadata and compressing them again. Results are kept in the cache directory\n#\t(defaults to false)\n";
+	}
+	str << "optimizeImages" << ":\t\t" << (_optimizeImages ? "true" : "false") << "\n";
+
+	if(includeHelp){
+		str << "\n# Set to true if you want resources and article files to be hard linked in the output instead of copied, when on the same volume. Output files should then never be edited directly\n#\t(defaults to false)\n";
+	}
+	str << "hardLinkResources" << ":\t\t" << (_hardLinkResources ? "true" : "false") << "\n";
+
+	if(includeHelp){
+		str << "\n# Set to true if you want images and files of published articles to be stored once in a shared media directory, named after their content, instead of next to each article\n#\t(defaults to false)\n";
+	}
+	str << "mediaStore" << ":\t\t" << (_mediaStore ? "true" : "false") << "\n";
+
+	if(includeHelp){
+		str << "\n# Set to true if you want generated pages, the feed and the sitemap to be minified (collapsed whitespace, no comments)\n#\t(defaults to false)\n";
+	}
+	str << "minifyPages" << ":\t\t" << (_minifyPages ? "true" : "false") << "\n";
+
+	if(includeHelp){
+		str << "\n# Set to true if you want template stylesheets and scripts to be minified and renamed after their content (style.3f9a1c2b.css), so that they can be cached indefinitely\n#\t(defaults to false)\n";
+	}
+	str << "fingerprintAssets" << ":\t\t" << (_fingerprintAssets ? "true" : "false") << "\n";
+
+	if(includeHelp){
+		str << "\n# Set to true if you want the stylesheet rules used by the template of each type of page to be inlined in its head, and the complete stylesheets to be loaded without blocking the display\n#\t(defaults to false)\n";
+	}
+	str << "criticalStyles" << ":\t\t" << (_criticalStyles ? "true" : "false") << "\n";
+
+	if(includeHelp){
+		str << "\n# Set to true if you want fenced code blocks of common languages to be highlighted during generation, using the highlight.js class names\n#\t(defaults to false)\n";
+	}
+	str << "highlightCode" << ":\t\t" << (_highlightCode ? "true" : "false") << "\n";
+
+	if(includeHelp){
+		str << "\n# Set to true if you want a full-text search index of published articles to be generated in the search directory, along with the search.js script to query it from pages\n#\t(defaults to false)\n";
+	}
+	str << "searchIndex" << ":\t\t" << (_searchIndex ? "true" : "false") << "\n";
+
+	if(includeHelp){
+		str << "\n# Size in megabytes of the rendered article pages kept in memory: pages are saved in batches of this size and their content released, 0 to render all pages before saving them\n#\t(defaults to 0)\n";
+	}
+	str << "memoryBudget" << ":\t\t" << _memoryBudget << "\n";
+
+	if(includeHelp){
+		str << "\n# Compression level (1 to 9) of the precompressed .gz copies written next to pages and text assets, 0 to disable them\n#\t(defaults to 0)\n";
+	}
+	str << "compressionLevel" << ":\t\t" << _compressionLevel << "\n";
 	
 	if(includeHelp){
-		str << "\n# The ftp address pointing to the exact folder where the output should be uploaded\n";
+		str << "\n# The ftp address pointing to the exact folder where the output should be uploaded\n# Use file:///path/to/folder to copy the output to a local folder instead\n";
 	}
 	str << "ftpAdress" << ":\t\t";
-	if(!_ftpDomain.empty() || !_ftpPath.empty()){
+	if(_ftpLocal){
+		str << "file://" << _ftpPath.generic_string();
+	} else if(!_ftpDomain.empty() || !_ftpPath.empty()){
 		str << _ftpDomain << ":" << _ftpPath.generic_string();
 	}
 	str << "\n";
@@ -193,6 +324,11 @@ std::string Settings::str(bool includeHelp){
 		str << "\n# The ftp port to use\n#\t(defaults to 22)\n";
 	}
 	str << "ftpPort" << ":\t\t" << _ftpPort << "\n";
+
+	if(includeHelp){
+		str << "\n# Set to true if you want files with identical content (such as images shared by articles) to be uploaded once, and symbolically linked on the server for other locations\n#\t(defaults to false)\n";
+	}
+	str << "ftpLinkDuplicates" << ":\t\t" << (_ftpLinkDuplicates ? "true" : "false") << "\n";
 	
 	if(includeHelp){
 		str << "\n# The online URL of the blog, without http:// (for RSS generation)\n";
@@ -214,6 +350,16 @@ std::string Settings::str(bool includeHelp){
 	}
 	str << "summaryLength" << ":\t\t" << _summaryLength << "\n";
 
+	if(includeHelp){
+		str << "\n# The number of articles on each index page, following pages are generated in a page subdirectory; 0 to list all articles on a single page\n#\t(defaults to 0)\n";
+	}
+	str << "indexPageSize" << ":\t\t" << _indexPageSize << "\n";
+
+	if(includeHelp){
+		str << "\n# The number of similar published articles listed on each article page, where the template contains {#RELATED}\n#\t(defaults to 3)\n";
+	}
+	str << "relatedCount" << ":\t\t" << _relatedCount << "\n";
+
 	if(includeHelp){
 		str << "\n# Set to true if you want an index page to be generated for each year\n#\t(defaults to false)\n";
 	}
@@ -40,6 +40,10 @@ public:
 		return _outputPath;
 	}
 
+	const fs::path & cachePath() const {
+		return _cachePath;
+	}
+
 	const std::string & defaultAuthor() const {
 		return _defaultAuthor;
 	}
@@ -84,6 +88,14 @@ public:
 		return _ftpPort;
 	}
 
+	bool ftpLinkDuplicates() const {
+		return _ftpLinkDuplicates;
+	}
+
+	bool ftpLocal() const {
+		return _ftpLocal;
+	}
+
 	unsigned int rssCount() const {
 		return _rssCount;
 	}
@@ -92,10 +104,74 @@ public:
 		return _summaryLength;
 	}
 
+	unsigned int indexPageSize() const {
+		return _indexPageSize;
+	}
+
+	unsigned int relatedCount() const {
+		return _relatedCount;
+	}
+
 	bool imagesLinks() const {
 		return _imagesLinks;
 	}
 
+	bool imageSizes() const {
+		return _imageSizes;
+	}
+
+	const std::vector<unsigned int> & responsiveWidths() const {
+		return _responsiveWidths;
+	}
+
+	int responsiveQuality() const {
+		return _responsiveQuality;
+	}
+
+	unsigned int inlineImageSize() const {
+		return _inlineImageSize;
+	}
+
+	bool optimizeImages() const {
+		return _optimizeImages;
+	}
+
+	bool hardLinkResources() const {
+		return _hardLinkResources;
+	}
+
+	bool mediaStore() const {
+		return _mediaStore;
+	}
+
+	int compressionLevel() const {
+		return _compressionLevel;
+	}
+
+	bool minifyPages() const {
+		return _minifyPages;
+	}
+
+	bool fingerprintAssets() const {
+		return _fingerprintAssets;
+	}
+
+	bool criticalStyles() const {
+		return _criticalStyles;
+	}
+
+	bool highlightCode() const {
+		return _highlightCode;
+	}
+
+	bool searchIndex() const {
+		return _searchIndex;
+	}
+
+	unsigned int memoryBudget() const {
+		return _memoryBudget;
+	}
+
 	bool calendarIndexPages() const {
 		return _calendarIndexPages;
 	}
@@ -119,6 +195,8 @@ private:
 	fs::path _articlesPath;
     /// The path to the output directory.
 	fs::path _outputPath;
+    /// The path to the cache directory.
+	fs::path _cachePath;
     /// The default author name to use when generating articles.
 	std::string _defaultAuthor = "";
     /// The format of the date used in the articles header.
@@ -143,12 +221,48 @@ private:
 	std::string _externalLink = "";
     /// The port to use to connect to the SFTP server.
 	int _ftpPort = 22;
+	/// Upload identical files only once, and create symbolic links on the server for other copies.
+	bool _ftpLinkDuplicates = false;
+	/// The upload target is a local directory instead of a SFTP server.
+	bool _ftpLocal = false;
 	/// Number of posts to display in the RSS feed.
 	unsigned int _rssCount = 10;
 	/// Number of characters of the article summaries on the index page
 	unsigned int _summaryLength = 400;
+	/// Number of articles on each index page, 0 to list all articles on a single page.
+	unsigned int _indexPageSize = 0;
+	/// Number of similar articles listed on each article page.
+	unsigned int _relatedCount = 3;
     /// Denotes if images in the generated HTML files should link to the raw image file.
 	bool _imagesLinks = false;
+	/// Add the dimensions of article images and lazy loading attributes.
+	bool _imageSizes = true;
+	/// Widths of the downscaled copies of article images, none if empty.
+	std::vector<unsigned int> _responsiveWidths;
+	/// JPEG quality of the downscaled copies.
+	int _responsiveQuality = 85;
+	/// Size in bytes under which article images are embedded in pages, 0 to disable.
+	unsigned int _inlineImageSize = 0;
+	/// Losslessly reduce the size of article images.
+	bool _optimizeImages = false;
+	/// Hard link resources and article files in the output instead of copying them.
+	bool _hardLinkResources = false;
+	/// Store article files once in a shared directory, named after their content.
+	bool _mediaStore = false;
+	/// Compression level of the gzip copies of text files, 0 to disable.
+	int _compressionLevel = 0;
+	/// Minify generated pages, feed and sitemap.
+	bool _minifyPages = false;
+	/// Minify template stylesheets and scripts and add their content hash to their name.
+	bool _fingerprintAssets = false;
+	/// Inline the stylesheet rules used by each type of page and defer the complete stylesheets.
+	bool _criticalStyles = false;
+	/// Highlight fenced code blocks during generation.
+	bool _highlightCode = false;
+	/// Generate a full-text search index of published articles.
+	bool _searchIndex = false;
+	/// Size in megabytes of the rendered pages kept in memory before saving them, 0 to render all pages first.
+	unsigned int _memoryBudget = 0;
 	/// Should index pages be generated for each year.
 	bool _calendarIndexPages = false;
 	/// Each category keyword links to the category page (instead of the overall categories list)
@@ -8,12 +8,18 @@
 #include "system/System.hpp"
 #include "system/TextUtilities.hpp"
 #include "system/SSHSFTP.hpp"
+#include "system/LocalTarget.hpp"
 #include "system/Keychain.hpp"
+#include "system/ConcurrentQueue.hpp"
+#include "system/Agent.hpp"
 
 #include <ctime>
 #include <iomanip>
+#include <memory>
 #include <chrono>
 #include <iostream>
+#include <unordered_set>
+#include <thread>
 
 class ThothConfig : public Config {
 public:
@@ -46,6 +52,24 @@ public:
 			if(arg.key == "scribe"){
 				action = GENERATE | UPLOAD;
 			}
+			if(arg.key == "agent"){
+				action = AGENT;
+				if(!arg.values.empty()){
+					try {
+						agentIdleTime = std::stoi(arg.values[0]);
+					} catch(...) {
+						agentIdleTime = 0;
+					}
+					if(agentIdleTime <= 0){
+						Log::Error() << Log::Config << "Invalid idle time for agent: " << arg.values[0] << "." << std::endl;
+						invalid = true;
+					}
+				}
+			}
+			if(arg.key == "stop-agent"){
+				action = AGENT;
+				stopAgent = true;
+			}
 			// Modifiers.
 			if(arg.key == "drafts-only" || arg.key == "d") {
 				mode &= ~ARTICLES;
@@ -67,6 +91,15 @@ public:
 			if(arg.key == "force" || arg.key == "f") {
 				mode |= FORCE;
 			}
+			if(arg.key == "sync" || arg.key == "s") {
+				mode |= SYNC;
+			}
+			if(arg.key == "plan") {
+				mode |= PLAN;
+			}
+			if(arg.key == "stats-json" && !arg.values.empty()) {
+				statsPath = arg.values[0];
+			}
 			// Infos.
 			if(arg.key == "version" || arg.key == "v") {
 				version = true;
@@ -94,13 +127,18 @@ public:
 		registerSection("Process");
 		registerArgument("generate", "", "Generates the site (specified by --path). All existing files are kept. Drafts are updated. New articles are added. Index is rebuilt.");
 		registerArgument("upload", "", "Upload to the SFTP server the content of the blog (specified by --path) that is not already present (except drafts).");
-		registerArgument("scribe", "", "Combines \"generate\" and \"upload\" with the corresponding config and options.");
+		registerArgument("scribe", "", "Combines \"generate\" and \"upload\" with the corresponding config and options, uploading pages while the site is generated.");
+		registerArgument("agent", "", "Connect to the SFTP server and keep the connection open in a background process, reused by later uploads for the same config until no upload happened for the given time (10 minutes by default). Not available on Windows.", "idle minutes");
+		registerArgument("stop-agent", "", "Stop the background agent for the config.");
 		
 		registerSection("Modifiers");
 		registerArgument("index-only", "i", "Update index pages only.");
 		registerArgument("drafts-only", "d", "Process drafts only.");
 		registerArgument("resources-only", "r", "Update resources only.");
 		registerArgument("force", "f", "Force generation/upload of all blog files");
+		registerArgument("sync", "s", "When uploading, remove remote article and category files that are not present in the output anymore.");
+		registerArgument("plan", "", "Instead of uploading, list new, changed and orphaned files and directories to create, and estimate the upload cost.");
+		registerArgument("stats-json", "", "Save statistics about each upload phase (per-operation latencies, round trips, throughput) to a JSON file. They are also logged with --verbose.", "path to file");
 		
 		registerSection("Infos");
 		registerArgument("version", "v", "Displays the current Thoth version.");
@@ -109,6 +147,12 @@ public:
 	}
 	
 	std::string path = "";
+
+	std::string statsPath = "";
+
+	int agentIdleTime = 10;
+	bool stopAgent = false;
+	bool invalid = false;
 	
 	// Tasks.
 	uint action = GENERATE | UPLOAD;
@@ -133,57 +177,97 @@ bool queryAndSetPassword(const Settings & settings){
 	return Keychain::setPassword(settings.ftpDomain(), settings.ftpUsername(), pass);
 }
 
-void upload(const uint mode, const Settings & settings, Server & server){
+/// Items of the output that are not resources.
+const std::vector<std::string> nonResourceItems = { "index.html", "index-drafts.html", "feed.xml", "sitemap.xml", "articles", "drafts", "categories", "media", "search", "page",
+	"index.html.gz", "index-drafts.html.gz", "feed.xml.gz", "sitemap.xml.gz" };
+/// Only directories fully managed by Thoth are pruned, the root can contain other user data.
+const std::vector<std::string> managedDirectories = { "articles", "categories", "media", "search", "page" };
+/// Hidden directory on the server storing the content of duplicated files, see Server::setLinkDuplicates.
+const std::string duplicatesDirectory = ".duplicates";
+
+/// Collect the statistics of each upload phase, for logging and an optional JSON report.
+class UploadReport {
+public:
+
+	void add(const std::string & phase, const DeployTarget::Stats & stats){
+		Log::Verbose() << Log::Upload << phase << ": " << stats.str() << std::endl;
+		_phases.push_back("{ \"phase\": \"" + phase + "\", \"stats\": " + stats.json() + " }");
+	}
+
+	bool save(const fs::path & path) const {
+		return System::writeStringToFile("[\n\t" + TextUtilities::join(_phases, ",\n\t") + "\n]\n", path);
+	}
+
+private:
+	std::vector<std::string> _phases;
+};
+
+void upload(const uint mode, const Settings & settings, DeployTarget & target, UploadReport & report, bool pagesUploaded = false){
 	const bool force = bool(mode & FORCE);
 	const fs::path src = settings.outputPath();
 	const fs::path dst = settings.ftpPath();
 
 	// We could copy the root and nothing else, but in case of forced upload it could erase other user data.
 	
-	if(mode & INDEX){
-		server.resetStats();
-		
-		Log::Info() << Log::Upload << "Uploading index pages..." << std::flush;
-		// Index pages are always forced to update.
-		const bool st0 = server.copyItem(src / "index.html", dst / "index.html", true);
-		const bool st2 = server.copyItem(src / "feed.xml", dst / "feed.xml", true);
-		const bool st3 = server.copyItem(src / "sitemap.xml", dst / "sitemap.xml", true);
-		// Never upload drafts
-		const bool st1 = true;//server.copyItem(src / "index-drafts.html", dst / "index-drafts.html", true);
-		// Ensure the categories directory exists.
-		server.createDirectory(dst / "categories", false);
-		const bool st4 = server.copyItem(src / "categories/index.html", dst / "categories/index.html", true);
-		if(st0 && st1 && st2 && st3 && st4){
-			const Server::Stats& stats = server.stats();
+	// Resources are uploaded first, so that pages never reference renamed stylesheets and scripts that are not on the server yet.
+	if(mode & RESOURCES){
+		target.resetStats();
+
+		Log::Info() << Log::Upload << "Uploading resources..." << std::flush;
+		const auto files = System::listItems(src, false, true);
+		bool st = true;
+		for(const auto & file : files){
+			const std::string filename = file.filename().string();
+			if(std::find(nonResourceItems.begin(), nonResourceItems.end(), filename) == nonResourceItems.end()){
+				const bool st0 = target.copyItem(file, dst / file.filename(), force);
+				st = st && st0;
+			}
+		}
+		if(st){
+			const DeployTarget::Stats& stats = target.stats();
 			Log::Info() << " done (" << stats.uploadedFiles << " files)." << std::endl;
 		} else {
 			Log::Info() << " fail." << std::endl;
 		}
+		report.add("resources", target.stats());
 	}
-	
+
+	bool articlesUploaded = true;
 	if(mode & ARTICLES){
-		server.resetStats();
+		target.resetStats();
 
 		Log::Info() << Log::Upload << "Uploading article and category pages..." << std::flush;
-		const bool st0 = server.copyItem(src / "articles", dst / "articles", force);
-		const bool st1 = server.copyItem(src / "categories", dst / "categories", force);
-		if(st0 && st1){
-			const Server::Stats& stats = server.stats();
-			Log::Info() << " done (" << stats.uploadedFiles << " files)." << std::endl;
+		// If modified pages have already been uploaded, only look for missing ones.
+		const bool forcePages = force && !pagesUploaded;
+		const bool st0 = target.copyItem(src / "articles", dst / "articles", forcePages);
+		const bool st1 = target.copyItem(src / "categories", dst / "categories", forcePages);
+		// Shared media files are named after their content, they never have to be replaced.
+		const bool st2 = !System::itemExists(src / "media") || target.copyItem(src / "media", dst / "media", false);
+		// Search index and script, with their compressed copies.
+		const bool st3 = !System::itemExists(src / "search") || target.copyItem(src / "search", dst / "search", forcePages);
+		articlesUploaded = st0 && st1 && st2 && st3;
+		if(articlesUploaded){
+			const DeployTarget::Stats& stats = target.stats();
+			Log::Info() << " done (" << stats.uploadedFiles << " files";
+			if(stats.linkedFiles != 0){
+				Log::Info() << ", " << stats.linkedFiles << " linked";
+			}
+			Log::Info() << ")." << std::endl;
 		} else {
 			Log::Info() << " fail." << std::endl;
 		}
+		report.add("articles", target.stats());
 	}
 	
 	/*
 	 // Never upload drafts
 	 if(mode & DRAFTS){
-		server.resetStats();
+		target.resetStats();
 
 		Log::Info() << Log::Upload << "Uploading draft pages..." << std::flush;
-		const bool st0 = server.copyItem(src / "drafts", dst / "drafts", force);
+		const bool st0 = target.copyItem(src / "drafts", dst / "drafts", force);
 		if(st0){
-			const Server::Stats& stats = server.stats();
+			const DeployTarget::Stats& stats = target.stats();
 			Log::Info() << " done (" << stats.uploadedFiles << " files)." << std::endl;
 		} else {
 			Log::Info() << " fail." << std::endl;
@@ -191,30 +275,484 @@ void upload(const uint mode, const Settings & settings, Server & server){
 	}
 	*/
 	
-	if(mode & RESOURCES){
-		server.resetStats();
-
-		const std::vector<std::string> nonResources = { "index.html", "index-drafts.html", "feed.xml", "sitemap.xml", "articles", "drafts", "categories"};
+	// Index pages are uploaded last, so that they never link to pages that are not on the server yet.
+	if(mode & INDEX){
+		target.resetStats();
 		
-		Log::Info() << Log::Upload << "Uploading resources..." << std::flush;
-		const auto files = System::listItems(src, false, true);
-		bool st = true;
-		for(const auto & file : files){
-			const std::string filename = file.filename().string();
-			if(std::find(nonResources.begin(), nonResources.end(), filename) == nonResources.end()){
-				const bool st0 = server.copyItem(file, dst / file.filename(), force);
-				st = st && st0;
+		Log::Info() << Log::Upload << "Uploading index pages..." << std::flush;
+		// Index pages are always forced to update.
+		const bool st0 = target.copyItem(src / "index.html", dst / "index.html", true);
+		// Following index pages, with their compressed copies.
+		const bool st6 = !System::itemExists(src / "page") || target.copyItem(src / "page", dst / "page", true);
+		const bool st2 = target.copyItem(src / "feed.xml", dst / "feed.xml", true);
+		const bool st3 = target.copyItem(src / "sitemap.xml", dst / "sitemap.xml", true);
+		// Never upload drafts
+		const bool st1 = true;//target.copyItem(src / "index-drafts.html", dst / "index-drafts.html", true);
+		// Ensure the categories directory exists.
+		target.createDirectory(dst / "categories", false);
+		const bool st4 = target.copyItem(src / "categories/index.html", dst / "categories/index.html", true);
+		// Compressed copies, if any.
+		bool st5 = true;
+		for(const char* page : { "index.html.gz", "feed.xml.gz", "sitemap.xml.gz", "categories/index.html.gz" }){
+			if(System::itemExists(src / page)){
+				st5 = target.copyItem(src / page, dst / page, true) && st5;
 			}
 		}
-		if(st){
-			const Server::Stats& stats = server.stats();
+		if(st0 && st1 && st2 && st3 && st4 && st5 && st6){
+			const DeployTarget::Stats& stats = target.stats();
 			Log::Info() << " done (" << stats.uploadedFiles << " files)." << std::endl;
 		} else {
 			Log::Info() << " fail." << std::endl;
 		}
+		report.add("index", target.stats());
+	}
+	
+	// Pages missing from the server would be mistaken for orphans.
+	if((mode & SYNC) && (mode & ARTICLES) && !articlesUploaded){
+		Log::Warning() << Log::Upload << "Skipping removal of orphaned pages, as the upload of pages failed." << std::endl;
+	} else if((mode & SYNC) && (mode & ARTICLES)){
+		target.resetStats();
+
+		Log::Info() << Log::Upload << "Removing orphaned pages..." << std::flush;
+		std::vector<DeployTarget::Item> orphans;
+		std::vector<DeployTarget::Item> links;
+		bool st = true;
+		for(const std::string & dir : managedDirectories){
+			std::vector<DeployTarget::Item> remoteItems;
+			// The directory might not exist yet on the target.
+			if(!target.itemExists(dst / dir)){
+				continue;
+			}
+			st = target.listItems(dst / dir, true, remoteItems) && st;
+
+			// A directory missing from the output is kept as is, the output might be incomplete.
+			const bool prune = System::itemExists(src / dir);
+			// Gather all local items relative to the output.
+			std::unordered_set<std::string> localPaths;
+			if(prune){
+				for(const auto & item : System::listItems(src / dir, true, true)){
+					localPaths.insert(item.lexically_relative(src).generic_string());
+				}
+			}
+			for(const DeployTarget::Item & item : remoteItems){
+				const std::string relPath = item.path.lexically_relative(dst).generic_string();
+				if(prune && localPaths.count(relPath) == 0){
+					orphans.push_back(item);
+				} else if(item.link){
+					links.push_back(item);
+				}
+			}
+		}
+		// The listing is recursive, so orphaned directories come with all their content.
+		const bool st0 = target.removeItems(orphans);
+
+		// Remove stored duplicated contents that are not linked anymore.
+		// Resources and index pages at the root can also be links.
+		const fs::path storeDir = dst / duplicatesDirectory;
+		bool st1 = true;
+		if(st && target.itemExists(storeDir)){
+			std::vector<DeployTarget::Item> rootItems;
+			st1 = target.listItems(dst, false, rootItems);
+			for(const DeployTarget::Item & item : rootItems){
+				const std::string filename = item.path.filename().string();
+				if(item.link){
+					links.push_back(item);
+				} else if(item.directory && System::isDirectory(src / filename)
+						  && std::find(nonResourceItems.begin(), nonResourceItems.end(), filename) == nonResourceItems.end()){
+					std::vector<DeployTarget::Item> resourceItems;
+					st1 = target.listItems(item.path, true, resourceItems) && st1;
+					for(const DeployTarget::Item & resource : resourceItems){
+						if(resource.link){
+							links.push_back(resource);
+						}
+					}
+				}
+			}
+			std::unordered_set<std::string> linkedPaths;
+			for(const DeployTarget::Item & link : links){
+				fs::path linkTarget;
+				st1 = target.readLink(link.path, linkTarget) && st1;
+				linkedPaths.insert((link.path.parent_path() / linkTarget).lexically_normal().generic_string());
+			}
+			std::vector<DeployTarget::Item> storedItems;
+			st1 = target.listItems(storeDir, false, storedItems) && st1;
+			// Only prune when all links are known.
+			if(st1){
+				std::vector<DeployTarget::Item> unused;
+				for(const DeployTarget::Item & item : storedItems){
+					if(linkedPaths.count(item.path.lexically_normal().generic_string()) == 0){
+						unused.push_back(item);
+					}
+				}
+				st1 = target.removeItems(unused);
+			}
+		}
+
+		if(st && st0 && st1){
+			const DeployTarget::Stats& stats = target.stats();
+			Log::Info() << " done (" << stats.removedItems << " items)." << std::endl;
+		} else {
+			Log::Info() << " fail." << std::endl;
+		}
+		report.add("sync", target.stats());
 	}
 }
 
+void plan(const uint mode, const Settings & settings, DeployTarget & target){
+	const bool force = bool(mode & FORCE);
+	const fs::path src = settings.outputPath();
+	const fs::path dst = settings.ftpPath();
+
+	struct LocalItem {
+		fs::path path;
+		uint64_t size = 0;
+		bool directory = false;
+		bool forced = false;
+	};
+
+	// Hidden items are never uploaded.
+	const auto isHidden = [](const fs::path & path){
+		for(const fs::path & component : path){
+			if(TextUtilities::hasPrefix(component.string(), ".")){
+				return true;
+			}
+		}
+		return false;
+	};
+
+	// Gather all local items that upload would consider, relative to the output directory.
+	std::vector<LocalItem> localItems;
+	std::vector<std::string> topLevelDirs;
+	const auto addLocalItem = [&](const fs::path & item, bool forced){
+		const fs::path relPath = item.lexically_relative(src);
+		if(isHidden(relPath) || !System::itemExists(item)){
+			return;
+		}
+		localItems.emplace_back();
+		localItems.back().path = relPath;
+		localItems.back().directory = System::isDirectory(item);
+		localItems.back().forced = forced;
+		if(!localItems.back().directory){
+			std::error_code ec;
+			localItems.back().size = uint64_t(fs::file_size(item, ec));
+			return;
+		}
+		for(const fs::path & subItem : System::listItems(item, true, true)){
+			const fs::path subRelPath = subItem.lexically_relative(src);
+			if(isHidden(subRelPath)){
+				continue;
+			}
+			localItems.emplace_back();
+			localItems.back().path = subRelPath;
+			localItems.back().directory = System::isDirectory(subItem);
+			localItems.back().forced = forced;
+			if(!localItems.back().directory){
+				std::error_code ec;
+				localItems.back().size = uint64_t(fs::file_size(subItem, ec));
+			}
+		}
+	};
+
+	if(mode & INDEX){
+		// Index pages are always forced to update, list them first so that this takes precedence.
+		for(const char* page : { "index.html", "page", "feed.xml", "sitemap.xml", "categories/index.html", "index.html.gz", "feed.xml.gz", "sitemap.xml.gz", "categories/index.html.gz" }){
+			addLocalItem(src / page, true);
+		}
+	}
+	if(mode & ARTICLES){
+		for(const std::string & dir : managedDirectories){
+			addLocalItem(src / dir, force);
+			topLevelDirs.push_back(dir);
+		}
+	}
+	if(mode & RESOURCES){
+		for(const fs::path & item : System::listItems(src, false, true)){
+			const std::string filename = item.filename().string();
+			if(std::find(nonResourceItems.begin(), nonResourceItems.end(), filename) == nonResourceItems.end()){
+				addLocalItem(item, force);
+				if(System::isDirectory(item)){
+					topLevelDirs.push_back(filename);
+				}
+			}
+		}
+	}
+
+	// Retrieve the remote state, listing directories instead of querying each file.
+	target.resetStats();
+	Log::Info() << Log::Upload << "Listing remote content..." << std::flush;
+	std::unordered_map<std::string, DeployTarget::Item> remoteItems;
+	std::vector<DeployTarget::Item> listing;
+	// Existence checks are single requests, time them to estimate the round trip latency.
+	std::vector<double> statTimes;
+	const auto timedExists = [&target, &statTimes](const fs::path & path){
+		const auto start = std::chrono::steady_clock::now();
+		const bool exists = target.itemExists(path);
+		statTimes.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+		return exists;
+	};
+	timedExists(dst);
+	target.listItems(dst, false, listing);
+	for(const std::string & dir : topLevelDirs){
+		if(timedExists(dst / dir)){
+			target.listItems(dst / dir, true, listing);
+		}
+	}
+	for(const DeployTarget::Item & item : listing){
+		remoteItems[item.path.lexically_relative(dst).generic_string()] = item;
+	}
+	// Use the median, a few slow requests should not skew the estimate.
+	std::sort(statTimes.begin(), statTimes.end());
+	const double latency = statTimes[statTimes.size() / 2];
+	Log::Info() << " done (" << listing.size() << " items)." << std::endl;
+
+	// Classify items, following the logic of Server::copyItem.
+	uint64_t roundTrips = 0;
+	uint64_t bytes = 0;
+	size_t newCount = 0, changedCount = 0, unchangedCount = 0, dirCount = 0, orphanCount = 0;
+	std::unordered_set<std::string> localPaths;
+	for(const LocalItem & item : localItems){
+		const std::string relPath = item.path.generic_string();
+		// Some items can be listed twice, for instance the categories index.
+		if(!localPaths.insert(relPath).second){
+			continue;
+		}
+		const auto remote = remoteItems.find(relPath);
+		const bool exists = remote != remoteItems.end();
+		// Existence check.
+		++roundTrips;
+		if(item.directory){
+			// Existence check before creation.
+			++roundTrips;
+			if(!exists){
+				++roundTrips;
+				++dirCount;
+				Log::Info() << "  d " << relPath << std::endl;
+			}
+			continue;
+		}
+		if(!exists){
+			roundTrips += target.copyOperations(item.size, false);
+			bytes += item.size;
+			++newCount;
+			Log::Info() << "  + " << relPath << " (" << item.size << " bytes)" << std::endl;
+		} else if(item.forced || remote->second.size != item.size){
+			roundTrips += target.copyOperations(item.size, true);
+			bytes += item.size;
+			++changedCount;
+			Log::Info() << "  ~ " << relPath << " (" << item.size << " bytes)" << std::endl;
+		} else {
+			++unchangedCount;
+			Log::Verbose() << "  = " << relPath << std::endl;
+		}
+	}
+	if(mode & ARTICLES){
+		for(const auto & remote : remoteItems){
+			const std::string & relPath = remote.first;
+			bool managed = false;
+			for(const std::string & dir : managedDirectories){
+				// Directories missing from the output are not pruned.
+				managed = managed || (TextUtilities::hasPrefix(relPath, dir + "/") && System::itemExists(src / dir));
+			}
+			if(!managed || localPaths.count(relPath) != 0){
+				continue;
+			}
+			++orphanCount;
+			if(mode & SYNC){
+				++roundTrips;
+			}
+			Log::Info() << "  - " << relPath << ((mode & SYNC) ? "" : " (kept, use --sync to remove)") << std::endl;
+		}
+	}
+
+	Log::Info() << Log::Upload << newCount << " new, " << changedCount << " changed, " << unchangedCount << " unchanged files, ";
+	Log::Info() << dirCount << " directories to create, " << orphanCount << " orphaned items." << std::endl;
+	Log::Info() << Log::Upload << std::fixed << std::setprecision(1) << "Estimated " << roundTrips << " round trips and " << (double(bytes) / 1024.0) << " KB to send";
+	Log::Info() << ", about " << (double(roundTrips) * latency) << "s at " << (latency * 1e3) << "ms per round trip." << std::endl;
+}
+
+/// Open the upload target, a local directory or a SFTP server. Returns null on failure.
+std::unique_ptr<DeployTarget> openTarget(const Settings & settings){
+	if(settings.ftpLocal()){
+		Log::Info() << Log::Upload << "Copying to " << settings.ftpPath().generic_string() << "." << std::endl;
+		if(!System::isDirectory(settings.ftpPath())){
+			Log::Error() << Log::Upload << "Target directory " << settings.ftpPath() << " does not exist." << std::endl;
+			return nullptr;
+		}
+		return std::unique_ptr<DeployTarget>(new LocalTarget());
+	}
+	Log::Info() << Log::Upload << "Connecting to " << settings.ftpUsername() << "@" << settings.ftpDomain() << ":" << settings.ftpPath().generic_string() << "." << std::endl;
+	std::unique_ptr<Server> server(new Server(settings.ftpDomain(), settings.ftpUsername(), settings.ftpPort()));
+	if(!server->authenticate(settings.ftpPassword())){
+		Log::Error() <<  Log::Server << "Error establishing a secure connection." << std::endl;
+		server->disconnect();
+		return nullptr;
+	}
+	server->setLinkDuplicates(settings.ftpLinkDuplicates(), settings.ftpPath() / duplicatesDirectory);
+	return std::unique_ptr<DeployTarget>(server.release());
+}
+
+int scribe(const uint mode, const Settings & settings, UploadReport & report){
+
+	struct PendingFile {
+		fs::path path;
+		bool changed = false;
+		bool resources = false; ///< Upload resources at this point instead of a file.
+	};
+
+	ConcurrentQueue<PendingFile> queue;
+	bool connected = false;
+
+	// Connect and upload pages in the background while the site is generated.
+	std::thread uploader([&queue, &connected, &settings, &report, mode](){
+		std::unique_ptr<DeployTarget> target = openTarget(settings);
+		connected = bool(target);
+		if(!connected){
+			// Stop accepting pages.
+			queue.close();
+			return;
+		}
+
+		const fs::path src = settings.outputPath();
+		const fs::path dst = settings.ftpPath();
+		std::unordered_set<std::string> knownDirs;
+		PendingFile file;
+		while(queue.pop(file)){
+			if(file.resources){
+				// Renamed assets are new files, the complete resources are uploaded again at the end.
+				upload(mode & RESOURCES, settings, *target, report);
+				continue;
+			}
+			// Ensure all parent directories exist, only checking each of them once.
+			fs::path dir;
+			for(const fs::path & component : file.path.parent_path()){
+				dir /= component;
+				if(knownDirs.insert(dir.generic_string()).second){
+					target->createDirectory(dst / dir, false);
+				}
+			}
+			// Modified pages have to replace their remote version even if the size is the same.
+			if(!target->copyItem(src / file.path, dst / file.path, file.changed)){
+				Log::Error() << Log::Upload << "Unable to upload " << file.path.generic_string() << "." << std::endl;
+			}
+		}
+		// Generation is complete, upload everything that is still missing, index pages last.
+		upload(mode, settings, *target, report, true);
+		target->disconnect();
+	});
+
+	Log::Info() << Log::Load << "Loading articles... ";
+	const auto articles = Article::loadArticles(settings.articlesPath(), settings);
+	Log::Info() << articles.size() << " found." << std::endl;
+
+	// Pages listing other pages are uploaded last, and drafts never. Following index pages are in page/, those of drafts in drafts/.
+	const std::unordered_set<std::string> deferredPages = { "index.html", "index-drafts.html", "feed.xml", "sitemap.xml", "categories/index.html" };
+	Generator generator(settings);
+	// Template resources are ready, upload them before any page referencing them.
+	queue.push({ fs::path(), false, true });
+	generator.setOutputListener([&queue, &deferredPages](const fs::path & path, bool changed){
+		std::string pathStr = path.generic_string();
+		// Compressed copies follow their page.
+		if(TextUtilities::hasSuffix(pathStr, ".gz")){
+			pathStr = pathStr.substr(0, pathStr.size() - 3);
+		}
+		if(deferredPages.count(pathStr) != 0 || TextUtilities::hasPrefix(pathStr, "page/") || TextUtilities::hasPrefix(pathStr, "drafts/")){
+			return;
+		}
+		queue.push({ path, changed });
+	});
+	generator.process(articles, mode);
+	queue.close();
+
+	uploader.join();
+	return connected ? 0 : 6;
+}
+
+int publish(const uint mode, const Settings & settings, DeployTarget & target, const std::string & statsPath){
+	if(mode & PLAN){
+		plan(mode, settings, target);
+		return 0;
+	}
+	UploadReport report;
+	upload(mode, settings, target, report);
+	if(!statsPath.empty()){
+		report.save(statsPath);
+	}
+	return 0;
+}
+
+int agent(const ThothConfig & config, const Settings & settings){
+	Agent agent(settings.selfPath());
+	if(config.stopAgent){
+		int res = 0;
+		if(!agent.forward({ "stop" }, res)){
+			Log::Info() << Log::Server << "No agent running for this configuration." << std::endl;
+		}
+		return 0;
+	}
+	if(settings.ftpLocal()){
+		Log::Error() << Log::Server << "The upload target is a local directory, no agent is needed." << std::endl;
+		return 7;
+	}
+	if(!Agent::supported()){
+		Log::Error() << Log::Server << "Agents are not supported on this platform." << std::endl;
+		return 7;
+	}
+	if(agent.running()){
+		Log::Error() << Log::Server << "An agent is already running for this configuration." << std::endl;
+		return 7;
+	}
+
+	Log::Info() << Log::Upload << "Connecting to " << settings.ftpUsername() << "@" << settings.ftpDomain() << ":" << settings.ftpPath().generic_string() << "." << std::endl;
+	std::unique_ptr<Server> server(new Server(settings.ftpDomain(), settings.ftpUsername(), settings.ftpPort()));
+	if(!server->authenticate(settings.ftpPassword())){
+		Log::Error() <<  Log::Server << "Error establishing a secure connection." << std::endl;
+		server->disconnect();
+		return 6;
+	}
+
+	const auto handler = [&server, &settings](const std::vector<std::string> & request){
+		if(request.size() != 3 || request[0] != "upload"){
+			Log::Error() << Log::Server << "Unknown agent request." << std::endl;
+			return 1;
+		}
+		// Requests come from a socket, they should never stop the agent.
+		unsigned long mode = 0;
+		try {
+			mode = std::stoul(request[1]);
+		} catch(...) {
+			Log::Error() << Log::Server << "Invalid agent request mode: " << request[1] << "." << std::endl;
+			return 1;
+		}
+		// The configuration might have been edited since the agent was started.
+		Settings currentSettings(settings.selfPath());
+		if(!currentSettings.load()){
+			return 1;
+		}
+		if(currentSettings.ftpDomain() != settings.ftpDomain() || currentSettings.ftpUsername() != settings.ftpUsername() || currentSettings.ftpPort() != settings.ftpPort()){
+			Log::Error() << Log::Server << "The server configuration has changed, restart the agent using --stop-agent then --agent." << std::endl;
+			return 1;
+		}
+		// The server might have closed the connection in the meantime.
+		if(!server->keepAlive()){
+			Log::Info() << Log::Upload << "Reconnecting to " << settings.ftpUsername() << "@" << settings.ftpDomain() << "." << std::endl;
+			server.reset(new Server(settings.ftpDomain(), settings.ftpUsername(), settings.ftpPort()));
+			if(!server->authenticate(settings.ftpPassword())){
+				Log::Error() <<  Log::Server << "Error establishing a secure connection." << std::endl;
+				return 6;
+			}
+		}
+		Log::Verbose() << Log::Upload << "Using connection held by the agent." << std::endl;
+		server->setLinkDuplicates(currentSettings.ftpLinkDuplicates(), currentSettings.ftpPath() / duplicatesDirectory);
+		return publish(uint(mode), currentSettings, *server, request[2]);
+	};
+	const auto keepAlive = [&server](){
+		return server->keepAlive();
+	};
+
+	const bool res = agent.serve(uint(config.agentIdleTime) * 60u, handler, keepAlive);
+	server->disconnect();
+	return res ? 0 : 7;
+}
 
 int main(int argc, char** argv){
 	
@@ -228,8 +766,8 @@ int main(int argc, char** argv){
 	} else if(config.bonus){
 		Log::Info() << bonusMessage << std::endl;
 		return 0;
-	} else if(config.showHelp(config.path.empty())){
-		return 0;
+	} else if(config.showHelp(config.path.empty() || config.invalid)){
+		return config.invalid ? 1 : 0;
 	}
 	
 	Settings settings(fs::path(config.path));
@@ -269,6 +807,14 @@ int main(int argc, char** argv){
 	
 	if(config.action & TEST){
 		Log::Info() << Log::Config << "Configuration contains: " << std::endl << settings.str(false) << std::endl;
+		if(settings.ftpLocal()){
+			if(System::isDirectory(settings.ftpPath())){
+				Log::Info() << Log::Upload << "Target directory " << settings.ftpPath() << " exists." << std::endl;
+			} else {
+				Log::Error() << Log::Upload << "Target directory " << settings.ftpPath() << " does not exist." << std::endl;
+			}
+			return 0;
+		}
 		Log::Info() << Log::Server << "Attempting to connect to " << settings.ftpUsername() << "@" << settings.ftpDomain() << ":" << settings.ftpPath().generic_string() << std::endl;
 		// Test connection to SFTP.
 		Server server(settings.ftpDomain(), settings.ftpUsername(), settings.ftpPort());
@@ -280,6 +826,21 @@ int main(int argc, char** argv){
 		return 0;
 	}
 	
+	if(config.action & AGENT){
+		return agent(config, settings);
+	}
+
+	// Generation and upload are overlapped, except when only planning the upload or when an agent already holds a connection.
+	Agent agent(settings.selfPath());
+	if((config.action & GENERATE) && (config.action & UPLOAD) && !(config.mode & PLAN) && !agent.running()){
+		UploadReport report;
+		const int res = scribe(config.mode, settings, report);
+		if(!config.statsPath.empty()){
+			report.save(config.statsPath);
+		}
+		return res;
+	}
+
 	if(config.action & GENERATE){
 		Log::Info() << Log::Load << "Loading articles... ";
 		const auto articles = Article::loadArticles(settings.articlesPath(), settings);
@@ -290,16 +851,19 @@ int main(int argc, char** argv){
 	}
 	
 	if(config.action & UPLOAD){
-		Log::Info() << Log::Upload << "Connecting to " << settings.ftpUsername() << "@" << settings.ftpDomain() << ":" << settings.ftpPath().generic_string() << "." << std::endl;
-		Server server(settings.ftpDomain(), settings.ftpUsername(), settings.ftpPort());
-		const bool res = server.authenticate(settings.ftpPassword());
-		if(!res){
-			Log::Error() <<  Log::Server << "Error establishing a secure connection." << std::endl;
-			server.disconnect();
+		// Forward the upload to the agent if there is one.
+		const std::string statsPath = config.statsPath.empty() ? "" : fs::absolute(config.statsPath).string();
+		int agentRes = 0;
+		if(agent.forward({ "upload", std::to_string(config.mode), statsPath }, agentRes)){
+			return agentRes;
+		}
+
+		std::unique_ptr<DeployTarget> target = openTarget(settings);
+		if(!target){
 			return 6;
 		}
-		upload(config.mode, settings, server);
-		server.disconnect();
+		publish(config.mode, settings, *target, statsPath);
+		target->disconnect();
 	}
 	
 	
@@ -0,0 +1,299 @@
+#include "system/Agent.hpp"
+
+#include <xxhash/xxhash.h>
+#include <chrono>
+#include <iostream>
+#include <sstream>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#endif
+
+/// Interval between two keep alive checks while waiting for requests, in seconds.
+static const double keepAliveInterval = 30.0;
+
+Agent::Agent(const fs::path & configPath){
+	const std::string pathStr = fs::absolute(configPath).lexically_normal().generic_string();
+	std::stringstream name;
+	name << "thoth-";
+#ifndef _WIN32
+	name << getuid() << "-";
+#endif
+	name << std::hex << XXH3_64bits(pathStr.c_str(), pathStr.size()) << ".sock";
+	std::error_code ec;
+	fs::path tempDir = fs::temp_directory_path(ec);
+	if(ec){
+		tempDir = "/tmp";
+	}
+	_socketPath = tempDir / name.str();
+}
+
+bool Agent::supported(){
+#ifdef _WIN32
+	return false;
+#else
+	return true;
+#endif
+}
+
+#ifdef _WIN32
+
+bool Agent::running() const {
+	return false;
+}
+
+bool Agent::forward(const std::vector<std::string> &, int &) const {
+	return false;
+}
+
+bool Agent::serve(unsigned int, const Handler &, const std::function<bool()> &){
+	Log::Error() << Log::Server << "Agents are not supported on this platform." << std::endl;
+	return false;
+}
+
+#else
+
+static bool fillAddress(const fs::path & path, sockaddr_un & address){
+	const std::string pathStr = path.string();
+	std::memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	if(pathStr.size() >= sizeof(address.sun_path)){
+		return false;
+	}
+	std::memcpy(address.sun_path, pathStr.c_str(), pathStr.size());
+	return true;
+}
+
+static int connectTo(const fs::path & path){
+	sockaddr_un address;
+	if(!fillAddress(path, address)){
+		return -1;
+	}
+	const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if(fd < 0){
+		return -1;
+	}
+	if(connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0){
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+static bool sendAll(int fd, const std::string & data){
+	size_t sent = 0;
+	while(sent < data.size()){
+		const ssize_t res = send(fd, data.data() + sent, data.size() - sent, 0);
+		if(res < 0 && errno == EINTR){
+			continue;
+		}
+		if(res <= 0){
+			return false;
+		}
+		sent += size_t(res);
+	}
+	return true;
+}
+
+bool Agent::running() const {
+	const int fd = connectTo(_socketPath);
+	if(fd < 0){
+		return false;
+	}
+	// An empty request is only answered with a result.
+	shutdown(fd, SHUT_WR);
+	char buffer[16];
+	while(recv(fd, buffer, sizeof(buffer), 0) > 0){}
+	close(fd);
+	return true;
+}
+
+bool Agent::forward(const std::vector<std::string> & request, int & result) const {
+	const int fd = connectTo(_socketPath);
+	if(fd < 0){
+		return false;
+	}
+	// One word per line, the end of the request is signaled by closing our side.
+	std::string message;
+	for(const std::string & word : request){
+		message += word + "\n";
+	}
+	if(!sendAll(fd, message)){
+		close(fd);
+		return false;
+	}
+	shutdown(fd, SHUT_WR);
+
+	// The output of the agent is followed by a null character and the result code.
+	std::string resultStr;
+	bool outputDone = false;
+	char buffer[4096];
+	ssize_t size = 0;
+	while((size = recv(fd, buffer, sizeof(buffer), 0)) != 0){
+		if(size < 0){
+			if(errno == EINTR){
+				continue;
+			}
+			break;
+		}
+		if(outputDone){
+			resultStr.append(buffer, size_t(size));
+			continue;
+		}
+		const char* end = static_cast<const char*>(std::memchr(buffer, '\0', size_t(size)));
+		const size_t outputSize = end ? size_t(end - buffer) : size_t(size);
+		std::cout.write(buffer, outputSize);
+		if(end){
+			outputDone = true;
+			resultStr.append(end + 1, size_t(size) - outputSize - 1);
+		}
+	}
+	std::cout << std::flush;
+	close(fd);
+
+	if(!outputDone || resultStr.empty()){
+		Log::Error() << Log::Server << "Connection to the agent was lost." << std::endl;
+		result = 1;
+		return true;
+	}
+	result = std::stoi(resultStr);
+	return true;
+}
+
+bool Agent::serve(unsigned int idleTime, const Handler & handler, const std::function<bool()> & keepAlive){
+	if(running()){
+		Log::Error() << Log::Server << "An agent is already running for this configuration." << std::endl;
+		return false;
+	}
+	sockaddr_un address;
+	if(!fillAddress(_socketPath, address)){
+		Log::Error() << Log::Server << "Agent socket path " << _socketPath << " is too long." << std::endl;
+		return false;
+	}
+	// Remove a socket left by an agent that did not exit properly.
+	unlink(_socketPath.c_str());
+
+	const int listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if(listenFd < 0){
+		Log::Error() << Log::Server << "Unable to create agent socket: " << std::strerror(errno) << std::endl;
+		return false;
+	}
+	// Only the current user can connect to the agent.
+	const mode_t previousMask = umask(0077);
+	const int bindRes = bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+	umask(previousMask);
+	if(bindRes != 0 || listen(listenFd, 4) != 0){
+		Log::Error() << Log::Server << "Unable to listen on agent socket " << _socketPath << ": " << std::strerror(errno) << std::endl;
+		close(listenFd);
+		return false;
+	}
+
+	const pid_t pid = fork();
+	if(pid < 0){
+		Log::Error() << Log::Server << "Unable to start agent process: " << std::strerror(errno) << std::endl;
+		close(listenFd);
+		unlink(_socketPath.c_str());
+		return false;
+	}
+	if(pid > 0){
+		Log::Info() << Log::Server << "Agent running in the background (process " << pid << "), it will stop after " << idleTime << "s without requests." << std::endl;
+		// Exit without any cleanup, the connections are now owned by the agent.
+		std::_Exit(0);
+	}
+
+	// Detach from the terminal.
+	setsid();
+	// A client leaving early should not stop the agent.
+	signal(SIGPIPE, SIG_IGN);
+	const int nullFd = open("/dev/null", O_RDWR);
+	dup2(nullFd, STDIN_FILENO);
+	dup2(nullFd, STDOUT_FILENO);
+	dup2(nullFd, STDERR_FILENO);
+
+	auto lastRequest = std::chrono::steady_clock::now();
+	while(true){
+		const double idle = std::chrono::duration<double>(std::chrono::steady_clock::now() - lastRequest).count();
+		if(idle >= double(idleTime)){
+			break;
+		}
+		pollfd pollInfo;
+		pollInfo.fd = listenFd;
+		pollInfo.events = POLLIN;
+		pollInfo.revents = 0;
+		const double waitTime = (std::min)(keepAliveInterval, double(idleTime) - idle);
+		const int pollRes = poll(&pollInfo, 1, int(waitTime * 1000.0) + 1);
+		if(pollRes < 0 && errno == EINTR){
+			continue;
+		}
+		if(pollRes < 0){
+			break;
+		}
+		if(pollRes == 0){
+			if(!keepAlive()){
+				break;
+			}
+			continue;
+		}
+
+		const int client = accept(listenFd, nullptr, nullptr);
+		if(client < 0){
+			continue;
+		}
+		// Don't wait forever for an incomplete request.
+		timeval timeout;
+		timeout.tv_sec = 5;
+		timeout.tv_usec = 0;
+		setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+		std::string message;
+		char buffer[1024];
+		ssize_t size = 0;
+		while((size = recv(client, buffer, sizeof(buffer), 0)) > 0){
+			message.append(buffer, size_t(size));
+		}
+		std::vector<std::string> request;
+		size_t start = 0;
+		size_t end = 0;
+		while((end = message.find('\n', start)) != std::string::npos){
+			request.push_back(message.substr(start, end - start));
+			start = end + 1;
+		}
+
+		int result = 0;
+		bool stop = false;
+		if(request.size() == 1 && request[0] == "stop"){
+			stop = true;
+		} else if(!request.empty()){
+			lastRequest = std::chrono::steady_clock::now();
+			// Send all output to the client while processing the request.
+			std::cout << std::flush;
+			std::cerr << std::flush;
+			dup2(client, STDOUT_FILENO);
+			dup2(client, STDERR_FILENO);
+			result = handler(request);
+			std::cout << std::flush;
+			std::cerr << std::flush;
+			dup2(nullFd, STDOUT_FILENO);
+			dup2(nullFd, STDERR_FILENO);
+		}
+		sendAll(client, std::string(1, '\0') + std::to_string(result));
+		close(client);
+		if(stop){
+			break;
+		}
+	}
+	close(listenFd);
+	close(nullFd);
+	unlink(_socketPath.c_str());
+	return true;
+}
+
+#endif
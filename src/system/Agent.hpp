@@ -0,0 +1,51 @@
+#pragma once
+
+#include "Common.hpp"
+#include "system/System.hpp"
+#include <functional>
+
+/**
+ \brief Background process serving requests from later invocations through a local socket, for instance to reuse an authenticated connection. Only supported on Unix systems.
+ \ingroup System
+ */
+class Agent {
+public:
+
+	/** Process a request, with the standard and error outputs redirected to the client.
+	 \param request the words of the request
+	 \return the result code sent back to the client
+	 */
+	using Handler = std::function<int(const std::vector<std::string> & request)>;
+
+	/** Constructor.
+	 \param configPath the configuration the agent is associated to, only one agent can run for a given configuration
+	 */
+	explicit Agent(const fs::path & configPath);
+
+	/** Check if an agent is running for the configuration.
+	 \return true if an agent accepted a connection
+	 */
+	bool running() const;
+
+	/** Send a request to the running agent and print its output.
+	 \param request the words of the request
+	 \param result will contain the result code returned by the agent
+	 \return false if no agent could be reached
+	 */
+	bool forward(const std::vector<std::string> & request, int & result) const;
+
+	/** Move the process to the background and serve requests until none has been received for the given duration.
+	 \param idleTime the maximum time without any request, in seconds
+	 \param handler the request handler
+	 \param keepAlive called regularly while idle, return false to stop the agent
+	 \return false if the agent could not be started, else the function only returns in the background process
+	 \note The calling process exits once the agent is listening.
+	 */
+	bool serve(unsigned int idleTime, const Handler & handler, const std::function<bool()> & keepAlive);
+
+	static bool supported();
+
+private:
+
+	fs::path _socketPath; ///< Local socket used to communicate with the agent.
+};
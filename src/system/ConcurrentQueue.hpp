@@ -0,0 +1,62 @@
+#pragma once
+
+#include "Common.hpp"
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+
+/**
+ \brief Unbounded queue shared between producer and consumer threads. Once closed, consumers drain the remaining items and no new item is accepted.
+ \ingroup System
+ */
+template<typename T>
+class ConcurrentQueue {
+public:
+
+	/** Add an item at the end of the queue.
+	 \param item the item to add
+	 \return false if the queue was already closed
+	 */
+	bool push(const T & item){
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			if(_closed){
+				return false;
+			}
+			_items.push_back(item);
+		}
+		_condition.notify_one();
+		return true;
+	}
+
+	/** Retrieve the first item of the queue, waiting for one to be available.
+	 \param item will contain the item
+	 \return false if the queue is closed and empty
+	 */
+	bool pop(T & item){
+		std::unique_lock<std::mutex> lock(_mutex);
+		_condition.wait(lock, [this]{ return _closed || !_items.empty(); });
+		if(_items.empty()){
+			return false;
+		}
+		item = _items.front();
+		_items.pop_front();
+		return true;
+	}
+
+	/** Mark the queue as complete, waking up all waiting consumers. */
+	void close(){
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_closed = true;
+		}
+		_condition.notify_all();
+	}
+
+private:
+
+	std::deque<T> _items; ///< Pending items.
+	std::mutex _mutex; ///< Protects items and state.
+	std::condition_variable _condition; ///< Signal new items or closing.
+	bool _closed = false; ///< Is the queue accepting items.
+};
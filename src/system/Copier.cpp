@@ -0,0 +1,96 @@
+#include "system/Copier.hpp"
+
+#include <atomic>
+#include <unordered_set>
+
+Copier::Copier(const fs::path & root, Manifest & manifest, bool useLinks) : _root(root), _manifest(manifest), _useLinks(useLinks) {
+}
+
+size_t Copier::copy(const std::vector<std::pair<fs::path, fs::path>> & items, bool force){
+	// Expand directories and create the destination hierarchy first.
+	std::vector<std::pair<fs::path, fs::path>> files;
+	std::unordered_set<std::string> directories;
+	const auto ensureDirectory = [&directories](const fs::path & dir){
+		if(directories.insert(dir.generic_string()).second && !System::itemExists(dir)){
+			System::createDirectory(dir);
+		}
+	};
+	for(const auto & item : items){
+		if(System::isDirectory(item.first)){
+			ensureDirectory(item.second);
+			for(const fs::path & subItem : System::listItems(item.first, true, true)){
+				const fs::path dst = item.second / subItem.lexically_relative(item.first);
+				if(System::isDirectory(subItem)){
+					ensureDirectory(dst);
+				} else {
+					files.emplace_back(subItem, dst);
+				}
+			}
+		} else {
+			ensureDirectory(item.second.parent_path());
+			files.emplace_back(item);
+		}
+	}
+
+	std::atomic<size_t> count(0);
+	System::forEachParallel(files.size(), [this, &files, &count, force](size_t i){
+		bool written = false;
+		if(!copyFile(files[i].first, files[i].second, force, written)){
+			Log::Error() << Log::Generation << "Unable to copy " << files[i].first << " to " << files[i].second << "." << std::endl;
+		}
+		if(written){
+			++count;
+		}
+	});
+	return count;
+}
+
+bool Copier::copyFile(const fs::path & src, const fs::path & dst, bool force, bool & written){
+	written = false;
+	const std::string key = dst.lexically_relative(_root).generic_string();
+	std::error_code ec;
+	const uint64_t srcSize = uint64_t(fs::file_size(src, ec));
+	if(ec){
+		return false;
+	}
+	const int64_t srcTime = Manifest::modificationTime(src);
+
+	if(!force && System::itemExists(dst)){
+		const uint64_t dstSize = uint64_t(fs::file_size(dst, ec));
+		const int64_t dstTime = Manifest::modificationTime(dst);
+		if(!ec && dstSize == srcSize){
+			// The file is known if it hasn't been modified since we wrote it.
+			Manifest::Entry entry;
+			const bool known = _manifest.get(key, entry) && entry.size == dstSize && entry.dstTime == dstTime;
+			if(known && entry.srcTime == srcTime){
+				return true;
+			}
+			// Timestamps have changed, compare the content.
+			const uint64_t srcHash = System::hashFile(src);
+			const uint64_t dstHash = (known && entry.hash != 0) ? entry.hash : System::hashFile(dst);
+			if(srcHash == dstHash){
+				_manifest.set(key, { srcSize, srcTime, dstTime, srcHash });
+				return true;
+			}
+		}
+	}
+
+	// Never write through the existing file, it could be a link to a source.
+	fs::remove(dst, ec);
+	bool done = false;
+	if(_useLinks){
+		ec.clear();
+		fs::create_hard_link(src, dst, ec);
+		done = !ec;
+	}
+	if(!done){
+		done = System::copyFile(src, dst) >= 0;
+	}
+	if(!done){
+		_manifest.remove(key);
+		return false;
+	}
+	written = true;
+	_manifest.set(key, { srcSize, srcTime, Manifest::modificationTime(dst), 0 });
+	return true;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "Common.hpp"
+#include "system/System.hpp"
+#include "system/Manifest.hpp"
+
+/**
+ \brief Copy files to a directory on several threads, skipping files already present with the same content according to a manifest.
+ \ingroup System
+ */
+class Copier {
+public:
+
+	/** Constructor.
+	 \param root the destination directory, described by the manifest
+	 \param manifest the manifest of the destination directory
+	 \param useLinks create hard links to the sources instead of copies when possible
+	 */
+	Copier(const fs::path & root, Manifest & manifest, bool useLinks);
+
+	/** Copy files and directories.
+	 \param items pairs of source and destination paths
+	 \param force copy even if the destination is up to date
+	 \return the number of files written
+	 */
+	size_t copy(const std::vector<std::pair<fs::path, fs::path>> & items, bool force);
+
+private:
+
+	/** Copy a file if needed.
+	 \param src the source file
+	 \param dst the destination file
+	 \param force copy even if the destination is up to date
+	 \param written will denote if the file was written
+	 \return false if the copy failed
+	 */
+	bool copyFile(const fs::path & src, const fs::path & dst, bool force, bool & written);
+
+	fs::path _root; ///< Destination directory.
+	Manifest & _manifest; ///< Content of the destination directory.
+	bool _useLinks; ///< Try to link files instead of copying.
+};
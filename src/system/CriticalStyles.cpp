@@ -0,0 +1,232 @@
+#include "system/CriticalStyles.hpp"
+#include "system/Minifier.hpp"
+#include "system/TextUtilities.hpp"
+
+#include <cctype>
+
+static bool isNameChar(char c){
+	return std::isalnum(static_cast<unsigned char>(c)) || c == '-' || c == '_' || (static_cast<unsigned char>(c) >= 0x80);
+}
+
+/// Find the end of a block starting after an opening brace, skipping nested blocks and strings.
+static size_t findBlockEnd(const std::string & css, size_t start){
+	int depth = 1;
+	size_t i = start;
+	while(i < css.size()){
+		const char c = css[i];
+		if(c == '"' || c == '\''){
+			++i;
+			while(i < css.size() && css[i] != c){
+				i += (css[i] == '\\') ? 2 : 1;
+			}
+		} else if(c == '{'){
+			++depth;
+		} else if(c == '}'){
+			--depth;
+			if(depth == 0){
+				return i;
+			}
+		}
+		++i;
+	}
+	return css.size();
+}
+
+std::string CriticalStyles::extract(const std::string & css, const std::string & markup, const std::string & base){
+	Usage usage;
+	collect(markup, usage);
+	const std::string result = filter(Minifier::css(css), usage);
+	return base.empty() ? result : rebase(result, base);
+}
+
+void CriticalStyles::collect(const std::string & markup, Usage & usage){
+	size_t pos = markup.find('<');
+	while(pos != std::string::npos){
+		size_t k = pos + 1;
+		std::string name;
+		while(k < markup.size() && isNameChar(markup[k])){
+			name.push_back(char(std::tolower(static_cast<unsigned char>(markup[k]))));
+			++k;
+		}
+		const size_t end = markup.find('>', k);
+		if(!name.empty()){
+			usage.tags.insert(name);
+			// Look for class and id attributes in the tag.
+			const std::string tag = markup.substr(k, end == std::string::npos ? std::string::npos : end - k);
+			for(const std::string attribute : { "class", "id" }){
+				size_t apos = tag.find(attribute + "=");
+				while(apos != std::string::npos){
+					const bool isAttribute = apos > 0 && (tag[apos - 1] == ' ' || tag[apos - 1] == '\t' || tag[apos - 1] == '\n');
+					size_t vpos = apos + attribute.size() + 1;
+					size_t vend = std::string::npos;
+					if(vpos < tag.size() && (tag[vpos] == '"' || tag[vpos] == '\'')){
+						vend = tag.find(tag[vpos], vpos + 1);
+						++vpos;
+					} else {
+						vend = tag.find_first_of(" \t\n/", vpos);
+					}
+					vend = vend == std::string::npos ? tag.size() : vend;
+					if(isAttribute){
+						const auto values = TextUtilities::split(tag.substr(vpos, vend - vpos), " ", true);
+						(attribute == "id" ? usage.ids : usage.classes).insert(values.begin(), values.end());
+					}
+					apos = tag.find(attribute + "=", vend);
+				}
+			}
+		}
+		pos = markup.find('<', k);
+	}
+}
+
+bool CriticalStyles::matches(const std::string & selector, const Usage & usage){
+	size_t i = 0;
+	while(i < selector.size()){
+		const char c = selector[i];
+		if(c == '.' || c == '#'){
+			size_t k = i + 1;
+			while(k < selector.size() && (isNameChar(selector[k]) || selector[k] == '\\')){
+				k += (selector[k] == '\\') ? 2 : 1;
+			}
+			const std::string name = selector.substr(i + 1, k - i - 1);
+			if((c == '.' ? usage.classes : usage.ids).count(name) == 0){
+				return false;
+			}
+			i = k;
+		} else if(c == ':'){
+			// Pseudo-classes and pseudo-elements don't restrict the match, their arguments are skipped.
+			size_t k = i + 1;
+			while(k < selector.size() && (selector[k] == ':' || isNameChar(selector[k]))){
+				++k;
+			}
+			if(k < selector.size() && selector[k] == '('){
+				int depth = 0;
+				while(k < selector.size()){
+					depth += selector[k] == '(' ? 1 : (selector[k] == ')' ? -1 : 0);
+					++k;
+					if(depth == 0){
+						break;
+					}
+				}
+			}
+			i = k;
+		} else if(c == '['){
+			// Attributes are assumed to be present.
+			const size_t end = selector.find(']', i);
+			i = end == std::string::npos ? selector.size() : end + 1;
+		} else if(isNameChar(c)){
+			size_t k = i;
+			while(k < selector.size() && isNameChar(selector[k])){
+				++k;
+			}
+			if(usage.tags.count(TextUtilities::lowercase(selector.substr(i, k - i))) == 0){
+				return false;
+			}
+			i = k;
+		} else {
+			// Universal selector and combinators.
+			++i;
+		}
+	}
+	return true;
+}
+
+std::string CriticalStyles::filter(const std::string & css, const Usage & usage){
+	std::string result;
+	size_t pos = 0;
+	while(pos < css.size()){
+		const size_t open = css.find_first_of("{;", pos);
+		if(open == std::string::npos){
+			break;
+		}
+		const std::string prelude = TextUtilities::trim(css.substr(pos, open - pos), " \t\n\r");
+		// At-rules without a block.
+		if(css[open] == ';'){
+			if(TextUtilities::hasPrefix(prelude, "@import")){
+				result.append(prelude + ";");
+			}
+			pos = open + 1;
+			continue;
+		}
+		const size_t close = findBlockEnd(css, open + 1);
+		const std::string block = css.substr(open + 1, close - open - 1);
+		pos = close + 1;
+
+		if(TextUtilities::hasPrefix(prelude, "@media") || TextUtilities::hasPrefix(prelude, "@supports")){
+			const std::string inner = filter(block, usage);
+			if(!inner.empty()){
+				result.append(prelude + "{" + inner + "}");
+			}
+			continue;
+		}
+		if(TextUtilities::hasPrefix(prelude, "@font-face")){
+			result.append(prelude + "{" + block + "}");
+			continue;
+		}
+		if(TextUtilities::hasPrefix(prelude, "@")){
+			// Animations, pages...
+			continue;
+		}
+		// Keep the rule if any of its selectors matches.
+		size_t start = 0;
+		int depth = 0;
+		bool keep = false;
+		for(size_t i = 0; i <= prelude.size() && !keep; ++i){
+			const char c = i < prelude.size() ? prelude[i] : ',';
+			depth += (c == '(' || c == '[') ? 1 : ((c == ')' || c == ']') ? -1 : 0);
+			if(c == ',' && depth == 0){
+				keep = matches(prelude.substr(start, i - start), usage);
+				start = i + 1;
+			}
+		}
+		if(keep){
+			result.append(prelude + "{" + block + "}");
+		}
+	}
+	return result;
+}
+
+std::string CriticalStyles::rebase(const std::string & css, const std::string & base){
+	std::string result;
+	size_t pos = 0;
+	while(pos < css.size()){
+		// URLs appear in url() functions, and as strings after @import.
+		const size_t urlPos = css.find("url(", pos);
+		const size_t importPos = css.find("@import", pos);
+		size_t start = (std::min)(urlPos, importPos);
+		if(start == std::string::npos){
+			break;
+		}
+		const bool isUrl = start == urlPos;
+		start += isUrl ? 4 : 7;
+		while(start < css.size() && (css[start] == ' ' || css[start] == '\t' || css[start] == '\n')){
+			++start;
+		}
+		if(start >= css.size()){
+			break;
+		}
+		const char quote = (css[start] == '"' || css[start] == '\'') ? css[start] : 0;
+		if(quote != 0){
+			++start;
+		} else if(!isUrl){
+			// @import followed by a url() function.
+			result.append(css, pos, start - pos);
+			pos = start;
+			continue;
+		}
+		const size_t end = quote != 0 ? css.find(quote, start) : css.find(')', start);
+		if(end == std::string::npos){
+			break;
+		}
+		const std::string url = css.substr(start, end - start);
+		result.append(css, pos, start - pos);
+		// Absolute URLs, data and fragments are kept.
+		const bool relative = !url.empty() && url[0] != '/' && url[0] != '#' && url.find(':') == std::string::npos;
+		if(relative){
+			result.append(base);
+		}
+		result.append(url);
+		pos = end;
+	}
+	result.append(css, pos, std::string::npos);
+	return result;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "Common.hpp"
+
+#include <unordered_set>
+
+/**
+ \brief Extract the part of a stylesheet needed to display some markup, so that it can be inlined in pages while the full stylesheet is loaded later.
+ \ingroup System
+ */
+class CriticalStyles {
+public:
+
+	/** Keep the rules of a stylesheet with at least one selector whose elements, classes and identifiers all appear in the markup. Media and support queries are filtered recursively, font faces and imports are kept, other at-rules are removed. Relative URLs are rebased so that they still resolve once the rules are inlined in a page.
+	 \param css the stylesheet content
+	 \param markup the HTML content to style
+	 \param base the directory of the stylesheet relative to the page, ending with a slash, or empty if they are in the same directory
+	 \return the minified critical rules
+	 */
+	static std::string extract(const std::string & css, const std::string & markup, const std::string & base);
+
+private:
+
+	/// Names of the elements, classes and identifiers used in markup.
+	struct Usage {
+		std::unordered_set<std::string> tags;
+		std::unordered_set<std::string> classes;
+		std::unordered_set<std::string> ids;
+	};
+
+	static void collect(const std::string & markup, Usage & usage);
+
+	static bool matches(const std::string & selector, const Usage & usage);
+
+	static std::string filter(const std::string & css, const Usage & usage);
+
+	static std::string rebase(const std::string & css, const std::string & base);
+};
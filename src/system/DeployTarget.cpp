@@ -0,0 +1,70 @@
+#include "system/DeployTarget.hpp"
+
+#include <iomanip>
+#include <sstream>
+
+static const std::array<std::string, DeployTarget::OPERATION_COUNT> operationNames = {"stat", "open", "write", "close", "mkdir", "rmdir", "unlink", "readdir", "link", "readlink", "rename"};
+
+double DeployTarget::OperationStats::percentile(double fraction) const {
+	const double target = fraction * double(count);
+	unsigned int accum = 0;
+	for(size_t bid = 0; bid < histogram.size(); ++bid){
+		accum += histogram[bid];
+		if(double(accum) >= target){
+			return double(1u << bid) * 1e-6;
+		}
+	}
+	return maxTime;
+}
+
+unsigned int DeployTarget::Stats::roundTrips() const {
+	unsigned int total = 0;
+	for(const OperationStats & op : operations){
+		total += op.count;
+	}
+	return total;
+}
+
+double DeployTarget::Stats::duration() const {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+std::string DeployTarget::Stats::str() const {
+	const double elapsed = duration();
+	std::stringstream str;
+	str << std::fixed << std::setprecision(1);
+	str << roundTrips() << " round trips in " << elapsed << "s, " << (double(bytesSent) / 1024.0) << " KB sent";
+	str << " (" << (elapsed > 0.0 ? double(bytesSent) / 1024.0 / elapsed : 0.0) << " KB/s)";
+	for(size_t oid = 0; oid < OPERATION_COUNT; ++oid){
+		const OperationStats & op = operations[oid];
+		if(op.count == 0){
+			continue;
+		}
+		str << "\n\t" << operationNames[oid] << ": " << op.count << " ops, total " << (op.totalTime * 1e3) << "ms";
+		str << ", mean " << (op.totalTime * 1e3 / double(op.count)) << "ms";
+		str << ", p50 < " << (op.percentile(0.5) * 1e3) << "ms, p90 < " << (op.percentile(0.9) * 1e3) << "ms";
+		str << ", max " << (op.maxTime * 1e3) << "ms";
+	}
+	return str.str();
+}
+
+std::string DeployTarget::Stats::json() const {
+	const double elapsed = duration();
+	std::stringstream str;
+	str << "{ \"duration\": " << elapsed << ", \"bytesSent\": " << bytesSent << ", \"roundTrips\": " << roundTrips();
+	str << ", \"throughput\": " << (elapsed > 0.0 ? double(bytesSent) / elapsed : 0.0);
+	str << ", \"uploadedFiles\": " << uploadedFiles << ", \"linkedFiles\": " << linkedFiles;
+	str << ", \"createdDirs\": " << createdDirs << ", \"removedItems\": " << removedItems;
+	str << ", \"operations\": {";
+	for(size_t oid = 0; oid < OPERATION_COUNT; ++oid){
+		const OperationStats & op = operations[oid];
+		str << (oid == 0 ? " " : ", ") << "\"" << operationNames[oid] << "\": { \"count\": " << op.count;
+		str << ", \"totalTime\": " << op.totalTime << ", \"maxTime\": " << op.maxTime << ", \"histogram\": [";
+		for(size_t bid = 0; bid < op.histogram.size(); ++bid){
+			str << (bid == 0 ? "" : ", ") << op.histogram[bid];
+		}
+		str << "] }";
+	}
+	str << " } }";
+	return str.str();
+}
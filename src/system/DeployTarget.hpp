@@ -0,0 +1,131 @@
+#pragma once
+
+#include "Common.hpp"
+#include "system/System.hpp"
+#include <array>
+#include <chrono>
+
+/**
+ \brief Destination of an upload, providing the operations needed to mirror the output there. Each operation is timed.
+ \ingroup System
+ */
+class DeployTarget {
+
+public:
+
+	/// Operations on the target, for a remote target each one costs a round trip.
+	enum Operation : uint {
+		STAT = 0,
+		OPEN,
+		WRITE,
+		CLOSE,
+		MKDIR,
+		RMDIR,
+		UNLINK,
+		READDIR,
+		LINK,
+		READLINK,
+		RENAME,
+		OPERATION_COUNT
+	};
+
+	struct OperationStats {
+		/// Bucket i counts operations that took less than 2^i microseconds.
+		std::array<unsigned int, 24> histogram{};
+		unsigned int count = 0;
+		double totalTime = 0.0;
+		double maxTime = 0.0;
+
+		/// Upper bound of the duration of the given fraction of operations, in seconds.
+		double percentile(double fraction) const;
+	};
+
+	struct Stats {
+		unsigned int uploadedFiles = 0;
+		unsigned int createdDirs = 0;
+		unsigned int removedItems = 0;
+		unsigned int linkedFiles = 0;
+		uint64_t bytesSent = 0;
+		std::array<OperationStats, OPERATION_COUNT> operations;
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		unsigned int roundTrips() const;
+
+		double duration() const;
+
+		std::string str() const;
+
+		std::string json() const;
+	};
+
+	struct Item {
+		fs::path path;
+		uint64_t size = 0;
+		bool directory = false;
+		bool link = false;
+	};
+
+	virtual ~DeployTarget() = default;
+
+	virtual void disconnect(){}
+
+	/// Check that the target is still reachable.
+	virtual bool keepAlive(){ return true; }
+
+	/// Copy a file or a directory, skipping files that are already present with the same size unless forced.
+	virtual bool copyItem(const fs::path & src, const fs::path & dst, bool force) = 0;
+
+	/// Number of operations needed to copy a file of the given size, replacing an existing one or not, for estimates.
+	virtual uint64_t copyOperations(uint64_t size, bool replace) const = 0;
+
+	virtual bool createDirectory(const fs::path & path, bool force = false) = 0;
+
+	virtual bool removeItem(const fs::path & path) = 0;
+
+	/// Remove items from a listing, directories are removed once their content has been.
+	virtual bool removeItems(const std::vector<Item> & items) = 0;
+
+	virtual bool renameItem(const fs::path & src, const fs::path & dst) = 0;
+
+	virtual bool listItems(const fs::path & path, bool recursive, std::vector<Item> & items) = 0;
+
+	virtual bool itemExists(const fs::path & path, uint64_t& size) = 0;
+
+	bool itemExists(const fs::path & path){
+		uint64_t size;
+		return itemExists(path, size);
+	}
+
+	virtual bool readLink(const fs::path & path, fs::path & target) = 0;
+
+	/// Files with identical content are only copied once in a store directory, then linked.
+	virtual void setLinkDuplicates(bool, const fs::path &){}
+
+	const Stats& stats() const { return _stats; }
+
+	void resetStats(){ _stats = Stats(); }
+
+protected:
+
+	template<typename F>
+	auto measure(Operation op, F && func){
+		const auto start = std::chrono::steady_clock::now();
+		auto res = func();
+		const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		OperationStats & opStats = _stats.operations[op];
+		++opStats.count;
+		opStats.totalTime += elapsed;
+		opStats.maxTime = (std::max)(opStats.maxTime, elapsed);
+		// Find the first power of two above the duration in microseconds.
+		size_t bucket = 0;
+		const double elapsedUs = elapsed * 1e6;
+		while(bucket + 1 < opStats.histogram.size() && double(1u << bucket) <= elapsedUs){
+			++bucket;
+		}
+		++opStats.histogram[bucket];
+		return res;
+	}
+
+	Stats _stats;
+};
@@ -0,0 +1,283 @@
+#include "system/Highlighter.hpp"
+#include "system/TextUtilities.hpp"
+
+#include <cctype>
+#include <unordered_map>
+
+static bool isWordStart(char c){
+	return std::isalpha(static_cast<unsigned char>(c)) || c == '_';
+}
+
+static bool isWordChar(char c){
+	return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+}
+
+static void appendEscaped(std::string & html, const std::string & code, size_t start, size_t end){
+	for(size_t i = start; i < end; ++i){
+		switch(code[i]){
+			case '&': html.append("&amp;"); break;
+			case '<': html.append("&lt;"); break;
+			case '>': html.append("&gt;"); break;
+			case '"': html.append("&quot;"); break;
+			default: html.push_back(code[i]); break;
+		}
+	}
+}
+
+static void appendToken(std::string & html, const char* type, const std::string & code, size_t start, size_t end){
+	html.append("<span class=\"hljs-");
+	html.append(type);
+	html.append("\">");
+	appendEscaped(html, code, start, end);
+	html.append("</span>");
+}
+
+const Highlighter::Language* Highlighter::language(const std::string & name){
+	static const std::unordered_map<std::string, Language> languages = [](){
+		std::unordered_map<std::string, Language> langs;
+
+		Language & cpp = langs["cpp"];
+		cpp.keywords = { "alignas", "alignof", "auto", "break", "case", "catch", "class", "const", "const_cast", "constexpr", "continue", "decltype", "default", "delete", "do", "dynamic_cast", "else", "enum", "explicit", "export", "extern", "final", "for", "friend", "goto", "if", "inline", "mutable", "namespace", "new", "noexcept", "operator", "override", "private", "protected", "public", "register", "reinterpret_cast", "return", "sizeof", "static", "static_assert", "static_cast", "struct", "switch", "template", "this", "thread_local", "throw", "try", "typedef", "typename", "union", "using", "virtual", "volatile", "while" };
+		cpp.types = { "void", "bool", "char", "short", "int", "long", "float", "double", "signed", "unsigned", "wchar_t", "char16_t", "char32_t", "size_t", "int8_t", "int16_t", "int32_t", "int64_t", "uint8_t", "uint16_t", "uint32_t", "uint64_t" };
+		cpp.literals = { "true", "false", "nullptr", "NULL" };
+		cpp.lineComment = "//";
+		cpp.blockCommentStart = "/*";
+		cpp.blockCommentEnd = "*/";
+		cpp.quotes = "\"'";
+		cpp.preprocessor = true;
+		cpp.charQuotes = true;
+
+		Language & shader = langs["glsl"];
+		shader = cpp;
+		shader.keywords = { "attribute", "uniform", "varying", "in", "out", "inout", "layout", "const", "if", "else", "for", "while", "do", "return", "break", "continue", "discard", "struct", "switch", "case", "default", "precision", "highp", "mediump", "lowp", "buffer", "shared", "flat", "smooth", "noperspective", "cbuffer", "register", "static", "inline", "kernel", "vertex", "fragment", "constant", "device", "thread", "threadgroup", "using", "namespace" };
+		shader.types = { "void", "bool", "int", "uint", "float", "double", "half", "vec2", "vec3", "vec4", "ivec2", "ivec3", "ivec4", "uvec2", "uvec3", "uvec4", "bvec2", "bvec3", "bvec4", "dvec2", "dvec3", "dvec4", "mat2", "mat3", "mat4", "mat2x2", "mat3x3", "mat4x4", "float2", "float3", "float4", "float2x2", "float3x3", "float4x4", "half2", "half3", "half4", "int2", "int3", "int4", "uint2", "uint3", "uint4", "sampler", "sampler2D", "sampler3D", "samplerCube", "sampler2DShadow", "image2D", "texture2d", "Texture2D", "SamplerState" };
+		shader.literals = { "true", "false" };
+
+		Language & csharp = langs["cs"];
+		csharp = cpp;
+		csharp.keywords = { "abstract", "as", "async", "await", "base", "break", "case", "catch", "checked", "class", "const", "continue", "default", "delegate", "do", "else", "enum", "event", "explicit", "extern", "finally", "fixed", "for", "foreach", "get", "goto", "if", "implicit", "in", "interface", "internal", "is", "lock", "namespace", "new", "operator", "out", "override", "params", "private", "protected", "public", "readonly", "ref", "return", "sealed", "set", "sizeof", "stackalloc", "static", "struct", "switch", "this", "throw", "try", "typeof", "unchecked", "unsafe", "using", "var", "virtual", "volatile", "while", "yield" };
+		csharp.types = { "bool", "byte", "char", "decimal", "double", "dynamic", "float", "int", "long", "object", "sbyte", "short", "string", "uint", "ulong", "ushort", "void" };
+		csharp.literals = { "true", "false", "null" };
+
+		Language & java = langs["java"];
+		java = cpp;
+		java.keywords = { "abstract", "assert", "break", "case", "catch", "class", "const", "continue", "default", "do", "else", "enum", "extends", "final", "finally", "for", "goto", "if", "implements", "import", "instanceof", "interface", "native", "new", "package", "private", "protected", "public", "record", "return", "static", "strictfp", "super", "switch", "synchronized", "this", "throw", "throws", "transient", "try", "var", "volatile", "while" };
+		java.types = { "boolean", "byte", "char", "double", "float", "int", "long", "short", "void", "String" };
+		java.literals = { "true", "false", "null" };
+		java.preprocessor = false;
+
+		Language & js = langs["js"];
+		js = java;
+		js.keywords = { "as", "async", "await", "break", "case", "catch", "class", "const", "continue", "debugger", "default", "delete", "do", "else", "export", "extends", "finally", "for", "from", "function", "get", "if", "import", "in", "instanceof", "let", "new", "of", "return", "set", "static", "super", "switch", "this", "throw", "try", "typeof", "var", "void", "while", "with", "yield" };
+		js.types = {};
+		js.literals = { "true", "false", "null", "undefined", "NaN", "Infinity" };
+		js.quotes = "\"'`";
+		js.charQuotes = false;
+
+		Language & ts = langs["ts"];
+		ts = js;
+		ts.keywords.insert({ "abstract", "declare", "enum", "implements", "interface", "keyof", "namespace", "private", "protected", "public", "readonly", "type" });
+		ts.types = { "any", "bigint", "boolean", "never", "number", "object", "string", "symbol", "unknown", "void" };
+
+		Language & swift = langs["swift"];
+		swift = java;
+		swift.keywords = { "any", "as", "associatedtype", "async", "await", "break", "case", "catch", "class", "continue", "default", "defer", "deinit", "do", "else", "enum", "extension", "fallthrough", "fileprivate", "final", "for", "func", "guard", "if", "import", "in", "init", "inout", "internal", "is", "lazy", "let", "mutating", "open", "operator", "override", "private", "protocol", "public", "repeat", "rethrows", "return", "self", "Self", "some", "static", "struct", "subscript", "super", "switch", "throw", "throws", "try", "typealias", "var", "weak", "where", "while" };
+		swift.types = { "Array", "Bool", "Character", "Dictionary", "Double", "Float", "Int", "Optional", "Set", "String", "UInt", "Void" };
+		swift.literals = { "true", "false", "nil" };
+		swift.quotes = "\"";
+
+		Language & rust = langs["rust"];
+		rust = java;
+		rust.keywords = { "as", "async", "await", "break", "const", "continue", "crate", "dyn", "else", "enum", "extern", "fn", "for", "if", "impl", "in", "let", "loop", "match", "mod", "move", "mut", "pub", "ref", "return", "self", "Self", "static", "struct", "super", "trait", "type", "unsafe", "use", "where", "while" };
+		rust.types = { "i8", "i16", "i32", "i64", "i128", "isize", "u8", "u16", "u32", "u64", "u128", "usize", "f32", "f64", "bool", "char", "str", "String", "Vec", "Option", "Result", "Box" };
+		rust.literals = { "true", "false", "None", "Some", "Ok", "Err" };
+
+		Language & go = langs["go"];
+		go = java;
+		go.keywords = { "break", "case", "chan", "const", "continue", "default", "defer", "else", "fallthrough", "for", "func", "go", "goto", "if", "import", "interface", "map", "package", "range", "return", "select", "struct", "switch", "type", "var" };
+		go.types = { "bool", "byte", "complex64", "complex128", "error", "float32", "float64", "int", "int8", "int16", "int32", "int64", "rune", "string", "uint", "uint8", "uint16", "uint32", "uint64", "uintptr" };
+		go.literals = { "true", "false", "nil", "iota" };
+		go.quotes = "\"'`";
+
+		Language & json = langs["json"];
+		json.literals = { "true", "false", "null" };
+		json.quotes = "\"";
+
+		Language & python = langs["python"];
+		python.keywords = { "and", "as", "assert", "async", "await", "break", "case", "class", "continue", "def", "del", "elif", "else", "except", "finally", "for", "from", "global", "if", "import", "in", "is", "lambda", "match", "nonlocal", "not", "or", "pass", "raise", "return", "try", "while", "with", "yield" };
+		python.types = { "bool", "bytes", "dict", "float", "int", "len", "list", "object", "print", "range", "set", "str", "super", "tuple", "type" };
+		python.literals = { "True", "False", "None" };
+		python.lineComment = "#";
+		python.quotes = "\"'";
+		python.tripleQuotes = true;
+
+		Language & shell = langs["bash"];
+		shell.keywords = { "case", "do", "done", "elif", "else", "esac", "export", "fi", "for", "function", "if", "in", "local", "return", "select", "then", "until", "while" };
+		shell.types = { "cd", "echo", "eval", "exec", "exit", "printf", "read", "set", "shift", "source", "test", "unset" };
+		shell.lineComment = "#";
+		shell.quotes = "\"'";
+		shell.variables = true;
+		return langs;
+	}();
+
+	static const std::unordered_map<std::string, std::string> aliases = {
+		{ "c", "cpp" }, { "c++", "cpp" }, { "cc", "cpp" }, { "h", "cpp" }, { "hpp", "cpp" }, { "cxx", "cpp" },
+		{ "hlsl", "glsl" }, { "metal", "glsl" }, { "shader", "glsl" }, { "vert", "glsl" }, { "frag", "glsl" },
+		{ "csharp", "cs" }, { "c#", "cs" }, { "javascript", "js" }, { "typescript", "ts" }, { "rs", "rust" }, { "golang", "go" },
+		{ "py", "python" }, { "sh", "bash" }, { "shell", "bash" }, { "zsh", "bash" }, { "console", "bash" }
+	};
+	std::string key = TextUtilities::lowercase(TextUtilities::trim(name, " \t\r\n"));
+	const auto alias = aliases.find(key);
+	if(alias != aliases.end()){
+		key = alias->second;
+	}
+	const auto lang = languages.find(key);
+	return lang == languages.end() ? nullptr : &lang->second;
+}
+
+bool Highlighter::highlight(const std::string & code, const std::string & languageName, std::string & html){
+	const Language* langPtr = language(languageName);
+	if(!langPtr){
+		return false;
+	}
+	const Language & lang = *langPtr;
+	const size_t size = code.size();
+	html.reserve(html.size() + size * 2);
+
+	bool lineStart = true;
+	size_t i = 0;
+	while(i < size){
+		const char c = code[i];
+		if(c == '\n'){
+			html.push_back(c);
+			lineStart = true;
+			++i;
+			continue;
+		}
+		if(c == ' ' || c == '\t' || c == '\r'){
+			html.push_back(c);
+			++i;
+			continue;
+		}
+		const bool atLineStart = lineStart;
+		lineStart = false;
+
+		// Directives extend to the end of the line, including escaped line breaks.
+		if(lang.preprocessor && atLineStart && c == '#'){
+			size_t end = i;
+			while(end < size && (code[end] != '\n' || (end > i && code[end - 1] == '\\'))){
+				++end;
+			}
+			appendToken(html, "meta", code, i, end);
+			i = end;
+			continue;
+		}
+		if(!lang.lineComment.empty() && code.compare(i, lang.lineComment.size(), lang.lineComment) == 0){
+			const size_t end = (std::min)(code.find('\n', i), size);
+			appendToken(html, "comment", code, i, end);
+			i = end;
+			continue;
+		}
+		if(!lang.blockCommentStart.empty() && code.compare(i, lang.blockCommentStart.size(), lang.blockCommentStart) == 0){
+			const size_t close = code.find(lang.blockCommentEnd, i + lang.blockCommentStart.size());
+			const size_t end = close == std::string::npos ? size : close + lang.blockCommentEnd.size();
+			appendToken(html, "comment", code, i, end);
+			i = end;
+			continue;
+		}
+		if(lang.tripleQuotes && (code.compare(i, 3, "\"\"\"") == 0 || code.compare(i, 3, "'''") == 0)){
+			const size_t close = code.find(code.substr(i, 3), i + 3);
+			const size_t end = close == std::string::npos ? size : close + 3;
+			appendToken(html, "string", code, i, end);
+			i = end;
+			continue;
+		}
+		// Character literals contain a single code point or an escape sequence, other single quotes are kept as-is (Rust lifetimes).
+		if(c == '\'' && lang.charQuotes){
+			size_t end = i + 1;
+			if(end < size && code[end] == '\\'){
+				end = code.find_first_of("'\n", end + 2);
+			} else if(end < size){
+				const unsigned char lead = static_cast<unsigned char>(code[end]);
+				end += lead >= 0xF0 ? 4 : (lead >= 0xE0 ? 3 : (lead >= 0xC0 ? 2 : 1));
+			}
+			if(end >= size || code[end] != '\''){
+				appendEscaped(html, code, i, i + 1);
+				++i;
+				continue;
+			}
+			appendToken(html, "string", code, i, end + 1);
+			i = end + 1;
+			continue;
+		}
+		if(lang.quotes.find(c) != std::string::npos){
+			// Only template strings span multiple lines, shell single quotes don't support escaping.
+			const bool escapes = !(lang.variables && c == '\'');
+			size_t end = i + 1;
+			while(end < size && code[end] != c && (c == '`' || code[end] != '\n')){
+				end += (escapes && code[end] == '\\') ? 2 : 1;
+			}
+			end = (std::min)(end + 1, size);
+			appendToken(html, "string", code, i, end);
+			i = end;
+			continue;
+		}
+		if(std::isdigit(static_cast<unsigned char>(c)) || (c == '.' && i + 1 < size && std::isdigit(static_cast<unsigned char>(code[i + 1])))){
+			size_t end = i + 1;
+			while(end < size){
+				const char n = code[end];
+				const char p = code[end - 1];
+				const bool exponentSign = (n == '+' || n == '-') && (p == 'e' || p == 'E') && !(code.compare(i, 2, "0x") == 0 || code.compare(i, 2, "0X") == 0);
+				if(!(isWordChar(n) || n == '.' || exponentSign)){
+					break;
+				}
+				++end;
+			}
+			appendToken(html, "number", code, i, end);
+			i = end;
+			continue;
+		}
+		if(lang.variables && c == '$' && i + 1 < size){
+			size_t end = i + 1;
+			if(code[end] == '{'){
+				end = (std::min)(code.find('}', end), size - 1) + 1;
+			} else {
+				while(end < size && isWordChar(code[end])){
+					++end;
+				}
+			}
+			if(end > i + 1){
+				appendToken(html, "variable", code, i, end);
+				i = end;
+				continue;
+			}
+		}
+		if(isWordStart(c)){
+			size_t end = i + 1;
+			while(end < size && isWordChar(code[end])){
+				++end;
+			}
+			const std::string word = code.substr(i, end - i);
+			size_t next = end;
+			while(next < size && (code[next] == ' ' || code[next] == '\t')){
+				++next;
+			}
+			if(lang.keywords.count(word) > 0){
+				appendToken(html, "keyword", code, i, end);
+			} else if(lang.types.count(word) > 0){
+				appendToken(html, "type", code, i, end);
+			} else if(lang.literals.count(word) > 0){
+				appendToken(html, "literal", code, i, end);
+			} else if(next < size && code[next] == '(' && !lang.keywords.empty()){
+				appendToken(html, "title", code, i, end);
+			} else {
+				appendEscaped(html, code, i, end);
+			}
+			i = end;
+			continue;
+		}
+		appendEscaped(html, code, i, i + 1);
+		++i;
+	}
+	return true;
+}
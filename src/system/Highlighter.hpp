@@ -0,0 +1,40 @@
+#pragma once
+
+#include "Common.hpp"
+
+#include <unordered_set>
+
+/**
+ \brief Highlight source code at generation time. Tokens are wrapped in spans using the highlight.js class names, so that existing highlight.js themes can be used.
+ \ingroup System
+ */
+class Highlighter {
+public:
+
+	/** Highlight a code block. Supported languages are C, C++, C#, GLSL, HLSL, Metal, Java, JavaScript, TypeScript, Swift, Rust, Go, JSON, Python and shell scripts.
+	 \param code the code to highlight
+	 \param language the name of the language, as written after the fence
+	 \param html will contain the escaped and highlighted code
+	 \return false if the language is not supported
+	 */
+	static bool highlight(const std::string & code, const std::string & language, std::string & html);
+
+private:
+
+	/// Syntax rules of a language.
+	struct Language {
+		std::unordered_set<std::string> keywords;
+		std::unordered_set<std::string> types;
+		std::unordered_set<std::string> literals;
+		std::string lineComment; ///< Start of comments ending with the line.
+		std::string blockCommentStart; ///< Start of comments ending with a delimiter, empty if not supported.
+		std::string blockCommentEnd; ///< End of block comments.
+		std::string quotes; ///< Characters delimiting strings.
+		bool preprocessor = false; ///< Lines starting with a hash are directives.
+		bool tripleQuotes = false; ///< Strings can be delimited by three quotes.
+		bool variables = false; ///< Words starting with a dollar are variables.
+		bool charQuotes = false; ///< Single quotes delimit characters instead of strings.
+	};
+
+	static const Language* language(const std::string & name);
+};
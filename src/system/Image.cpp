@@ -0,0 +1,305 @@
+#include "system/Image.hpp"
+#include "system/TextUtilities.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <cstring>
+
+Image::Image(unsigned int width, unsigned int height, unsigned int channels) :
+	_width(width), _height(height), _channels(channels), _pixels(size_t(width) * height * channels, 0) {
+}
+
+bool Image::supported(const fs::path & path){
+	const std::string ext = TextUtilities::lowercase(path.extension().string());
+	return ext == ".png" || ext == ".jpg" || ext == ".jpeg";
+}
+
+static bool readFile(const fs::path & path, std::string & data){
+	std::ifstream file(System::widen(path.string()), std::ios::in | std::ios::binary);
+	if(!file.is_open()){
+		return false;
+	}
+	std::stringstream buffer;
+	buffer << file.rdbuf();
+	data = buffer.str();
+	return true;
+}
+
+static bool writeFile(const fs::path & path, const std::string & data){
+	std::ofstream file(System::widen(path.string()), std::ios::out | std::ios::binary | std::ios::trunc);
+	if(!file.is_open()){
+		return false;
+	}
+	file.write(data.data(), std::streamsize(data.size()));
+	return bool(file);
+}
+
+static bool isPng(const std::string & data){
+	return data.size() >= 8 && std::memcmp(data.data(), "\x89PNG\r\n\x1a\n", 8) == 0;
+}
+
+static bool isJpeg(const std::string & data){
+	return data.size() >= 2 && uint8_t(data[0]) == 0xFF && uint8_t(data[1]) == 0xD8;
+}
+
+bool Image::load(const fs::path & path){
+	std::string data;
+	if(!readFile(path, data)){
+		return false;
+	}
+	_profile.clear();
+	if(isPng(data)){
+		return decodePng(data);
+	}
+	if(isJpeg(data)){
+		return decodeJpeg(data);
+	}
+	return false;
+}
+
+bool Image::optimize(const fs::path & src, const fs::path & dst){
+	std::string data;
+	if(!readFile(src, data)){
+		return false;
+	}
+	std::string optimized;
+	const bool done = isPng(data) ? optimizePng(data, optimized) : (isJpeg(data) && optimizeJpeg(data, optimized));
+	// Keep the original if it can't be improved.
+	return writeFile(dst, (done && optimized.size() < data.size()) ? optimized : data);
+}
+
+bool Image::save(const fs::path & path, int quality) const {
+	if(_pixels.empty()){
+		return false;
+	}
+	const std::string ext = TextUtilities::lowercase(path.extension().string());
+	std::string data;
+	const bool encoded = ext == ".png" ? encodePng(data) : ((ext == ".jpg" || ext == ".jpeg") && encodeJpeg(data, quality));
+	return encoded && writeFile(path, data);
+}
+
+/// Source pixels covered by a destination pixel along one axis, with their coverage.
+struct Footprint {
+	unsigned int start = 0;
+	std::vector<float> weights;
+};
+
+static std::vector<Footprint> computeFootprints(unsigned int srcSize, unsigned int dstSize){
+	std::vector<Footprint> footprints(dstSize);
+	const double scale = double(srcSize) / double(dstSize);
+	for(unsigned int i = 0; i < dstSize; ++i){
+		const double begin = double(i) * scale;
+		const double end = (std::min)(double(i + 1) * scale, double(srcSize));
+		Footprint & footprint = footprints[i];
+		footprint.start = unsigned(begin);
+		for(unsigned int s = footprint.start; double(s) < end; ++s){
+			const double coverage = (std::min)(end, double(s + 1)) - (std::max)(begin, double(s));
+			footprint.weights.push_back(float(coverage / scale));
+		}
+	}
+	return footprints;
+}
+
+Image Image::resized(unsigned int width) const {
+	width = (std::max)(1u, (std::min)(width, _width));
+	const unsigned int height = (std::max)(1u, unsigned(std::lround(double(_height) * double(width) / double(_width))));
+	Image dst(width, height, _channels);
+	dst._profile = _profile;
+	if(_pixels.empty()){
+		return dst;
+	}
+	// Color is averaged with alpha premultiplied, so that transparent pixels don't bleed.
+	const bool hasAlpha = _channels == 2 || _channels == 4;
+	const unsigned int colorCount = hasAlpha ? _channels - 1 : _channels;
+	const std::vector<Footprint> columns = computeFootprints(_width, width);
+	const std::vector<Footprint> rows = computeFootprints(_height, height);
+
+	// Horizontal pass.
+	std::vector<float> temp(size_t(width) * _height * _channels, 0.0f);
+	for(unsigned int y = 0; y < _height; ++y){
+		const uint8_t* srcRow = &_pixels[size_t(y) * _width * _channels];
+		float* dstRow = &temp[size_t(y) * width * _channels];
+		for(unsigned int x = 0; x < width; ++x){
+			const Footprint & footprint = columns[x];
+			float* dstPixel = dstRow + size_t(x) * _channels;
+			for(size_t i = 0; i < footprint.weights.size(); ++i){
+				const uint8_t* srcPixel = srcRow + size_t(footprint.start + i) * _channels;
+				const float alpha = hasAlpha ? float(srcPixel[colorCount]) / 255.0f : 1.0f;
+				const float weight = footprint.weights[i];
+				for(unsigned int c = 0; c < colorCount; ++c){
+					dstPixel[c] += weight * alpha * float(srcPixel[c]);
+				}
+				if(hasAlpha){
+					dstPixel[colorCount] += weight * float(srcPixel[colorCount]);
+				}
+			}
+		}
+	}
+	// Vertical pass.
+	std::vector<float> pixel(_channels);
+	for(unsigned int y = 0; y < height; ++y){
+		const Footprint & footprint = rows[y];
+		for(unsigned int x = 0; x < width; ++x){
+			std::fill(pixel.begin(), pixel.end(), 0.0f);
+			for(size_t i = 0; i < footprint.weights.size(); ++i){
+				const float* srcPixel = &temp[(size_t(footprint.start + i) * width + x) * _channels];
+				for(unsigned int c = 0; c < _channels; ++c){
+					pixel[c] += footprint.weights[i] * srcPixel[c];
+				}
+			}
+			if(hasAlpha){
+				const float alpha = pixel[colorCount] / 255.0f;
+				for(unsigned int c = 0; c < colorCount; ++c){
+					pixel[c] = alpha > 0.0f ? pixel[c] / alpha : 0.0f;
+				}
+			}
+			uint8_t* dstPixel = &dst._pixels[(size_t(y) * width + x) * _channels];
+			for(unsigned int c = 0; c < _channels; ++c){
+				dstPixel[c] = uint8_t((std::min)((std::max)(std::lround(pixel[c]), 0l), 255l));
+			}
+		}
+	}
+	return dst;
+}
+
+void Image::orient(int orientation){
+	if(orientation <= 1 || orientation > 8 || _pixels.empty()){
+		return;
+	}
+	// Orientations 5 to 8 swap rows and columns.
+	const bool transpose = orientation >= 5;
+	const unsigned int width = transpose ? _height : _width;
+	const unsigned int height = transpose ? _width : _height;
+	std::vector<uint8_t> pixels(_pixels.size());
+	for(unsigned int y = 0; y < height; ++y){
+		for(unsigned int x = 0; x < width; ++x){
+			// Find the stored pixel displayed at this position.
+			unsigned int sx = x;
+			unsigned int sy = y;
+			switch(orientation){
+				case 2: sx = _width - 1 - x; break;
+				case 3: sx = _width - 1 - x; sy = _height - 1 - y; break;
+				case 4: sy = _height - 1 - y; break;
+				case 5: sx = y; sy = x; break;
+				case 6: sx = y; sy = _height - 1 - x; break;
+				case 7: sx = _width - 1 - y; sy = _height - 1 - x; break;
+				case 8: sx = _width - 1 - y; sy = x; break;
+				default: break;
+			}
+			std::copy_n(&_pixels[(size_t(sy) * _width + sx) * _channels], _channels, &pixels[(size_t(y) * width + x) * _channels]);
+		}
+	}
+	_pixels = std::move(pixels);
+	_width = width;
+	_height = height;
+}
+
+static uint32_t readBE(const unsigned char* data, size_t count){
+	uint32_t value = 0;
+	for(size_t i = 0; i < count; ++i){
+		value = (value << 8) | data[i];
+	}
+	return value;
+}
+
+static uint32_t readLE(const unsigned char* data, size_t count){
+	uint32_t value = 0;
+	for(size_t i = count; i > 0; --i){
+		value = (value << 8) | data[i - 1];
+	}
+	return value;
+}
+
+/// Look for the first frame header in the JPEG segments.
+static bool probeJpeg(std::ifstream & file, int & width, int & height, std::string & exif){
+	file.seekg(2);
+	unsigned char marker[4];
+	while(file.read(reinterpret_cast<char*>(marker), 4)){
+		if(marker[0] != 0xFF){
+			return false;
+		}
+		// Padding bytes.
+		if(marker[1] == 0xFF){
+			file.seekg(-3, std::ios::cur);
+			continue;
+		}
+		const uint32_t length = readBE(marker + 2, 2);
+		if(length < 2){
+			return false;
+		}
+		// Start of frame markers, excluding DHT, JPG and DAC.
+		const unsigned char type = marker[1];
+		// Keep the EXIF segment, that can store a rotation.
+		if(type == 0xE1 && exif.empty()){
+			exif.resize(length - 2);
+			if(!file.read(&exif[0], std::streamsize(exif.size()))){
+				return false;
+			}
+			continue;
+		}
+		if(type >= 0xC0 && type <= 0xCF && type != 0xC4 && type != 0xC8 && type != 0xCC){
+			unsigned char frame[5];
+			if(!file.read(reinterpret_cast<char*>(frame), 5)){
+				return false;
+			}
+			height = int(readBE(frame + 1, 2));
+			width = int(readBE(frame + 3, 2));
+			return true;
+		}
+		file.seekg(length - 2, std::ios::cur);
+	}
+	return false;
+}
+
+bool Image::probeSize(const fs::path & path, int & width, int & height){
+	std::ifstream file(System::widen(path.string()), std::ios::in | std::ios::binary);
+	if(!file.is_open()){
+		return false;
+	}
+	unsigned char header[32] = {0};
+	file.read(reinterpret_cast<char*>(header), sizeof(header));
+	const size_t size = size_t(file.gcount());
+	file.clear();
+
+	if(size >= 24 && std::memcmp(header, "\x89PNG\r\n\x1a\n", 8) == 0){
+		width = int(readBE(header + 16, 4));
+		height = int(readBE(header + 20, 4));
+		return true;
+	}
+	if(size >= 10 && (std::memcmp(header, "GIF87a", 6) == 0 || std::memcmp(header, "GIF89a", 6) == 0)){
+		width = int(readLE(header + 6, 2));
+		height = int(readLE(header + 8, 2));
+		return true;
+	}
+	if(size >= 30 && std::memcmp(header, "RIFF", 4) == 0 && std::memcmp(header + 8, "WEBP", 4) == 0){
+		if(std::memcmp(header + 12, "VP8 ", 4) == 0){
+			width = int(readLE(header + 26, 2) & 0x3FFF);
+			height = int(readLE(header + 28, 2) & 0x3FFF);
+			return true;
+		}
+		if(std::memcmp(header + 12, "VP8L", 4) == 0){
+			const uint32_t bits = readLE(header + 21, 4);
+			width = int(bits & 0x3FFF) + 1;
+			height = int((bits >> 14) & 0x3FFF) + 1;
+			return true;
+		}
+		if(std::memcmp(header + 12, "VP8X", 4) == 0){
+			width = int(readLE(header + 24, 3)) + 1;
+			height = int(readLE(header + 27, 3)) + 1;
+			return true;
+		}
+		return false;
+	}
+	if(size >= 2 && header[0] == 0xFF && header[1] == 0xD8){
+		std::string exif;
+		if(!probeJpeg(file, width, height, exif)){
+			return false;
+		}
+		// Orientations 5 to 8 rotate the image by a quarter turn.
+		if(exifOrientation(exif, 0, exif.size()) >= 5){
+			std::swap(width, height);
+		}
+		return true;
+	}
+	return false;
+}
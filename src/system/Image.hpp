@@ -0,0 +1,100 @@
+#pragma once
+
+#include "Common.hpp"
+#include "system/System.hpp"
+
+/**
+ \brief Image with 8 bits per channel, that can be loaded from and saved to PNG and baseline JPEG files. Also reads information about image files without decoding them.
+ \ingroup System
+ */
+class Image {
+public:
+
+	Image() = default;
+
+	/** Constructor, pixels are initialized to zero.
+	 \param width the width in pixels
+	 \param height the height in pixels
+	 \param channels the number of channels (1: gray, 2: gray and alpha, 3: RGB, 4: RGBA)
+	 */
+	Image(unsigned int width, unsigned int height, unsigned int channels);
+
+	/** Load an image from a PNG or JPEG file. Interlaced PNG and progressive JPEG files are not supported. JPEG images are rotated following their EXIF orientation, and their color profile is kept when saving to JPEG.
+	 \param path the image file
+	 \return true if the image was decoded
+	 */
+	bool load(const fs::path & path);
+
+	/** Save the image to a PNG or JPEG file, based on the extension of the path.
+	 \param path the destination file
+	 \param quality the JPEG quality, from 1 to 100
+	 \return true if the image was written
+	 */
+	bool save(const fs::path & path, int quality = 85) const;
+
+	/** Reduce the size of a PNG or JPEG file without changing its pixels. Metadata that doesn't affect how the image is displayed is removed, PNG data is filtered and compressed again and JPEG data is encoded with Huffman tables optimized for its content.
+	 \param src the image file
+	 \param dst the destination file, a copy of the source if it can't be reduced
+	 \return false if the destination could not be written
+	 */
+	static bool optimize(const fs::path & src, const fs::path & dst);
+
+	/** Downscale the image, keeping its aspect ratio. Each destination pixel is the average of the source pixels it covers.
+	 \param width the destination width, should be smaller than the current width
+	 \return the downscaled image
+	 */
+	Image resized(unsigned int width) const;
+
+	unsigned int width() const { return _width; }
+
+	unsigned int height() const { return _height; }
+
+	unsigned int channels() const { return _channels; }
+
+	/** Read the dimensions of an image from its header, as displayed for JPEG files with an EXIF orientation. Supports PNG, JPEG, GIF and WebP files.
+	 \param path the image file
+	 \param width will contain the width in pixels
+	 \param height will contain the height in pixels
+	 \return true if the format was recognized and the dimensions read
+	 */
+	static bool probeSize(const fs::path & path, int & width, int & height);
+
+	/** Check if images can be loaded from and saved to files with the extension of a path.
+	 \param path the file path
+	 \return true for PNG and JPEG files
+	 */
+	static bool supported(const fs::path & path);
+
+private:
+
+	bool decodePng(const std::string & data);
+
+	bool encodePng(std::string & data) const;
+
+	bool decodeJpeg(const std::string & data);
+
+	bool encodeJpeg(std::string & data, int quality) const;
+
+	static bool optimizePng(const std::string & src, std::string & dst);
+
+	static bool optimizeJpeg(const std::string & src, std::string & dst);
+
+	/** Read the orientation stored in a JPEG EXIF segment.
+	 \param data the file data
+	 \param start the start of the segment content
+	 \param end the end of the segment
+	 \return the orientation, from 1 to 8, or 1 if absent
+	 */
+	static int exifOrientation(const std::string & data, size_t start, size_t end);
+
+	/** Flip and rotate the pixels so that they are stored as displayed.
+	 \param orientation the EXIF orientation, from 1 to 8
+	 */
+	void orient(int orientation);
+
+	unsigned int _width = 0; ///< Width in pixels.
+	unsigned int _height = 0; ///< Height in pixels.
+	unsigned int _channels = 0; ///< Number of channels.
+	std::vector<uint8_t> _pixels; ///< Interleaved pixel values, row by row.
+	std::string _profile; ///< ICC profile segments of a decoded JPEG file.
+};
@@ -0,0 +1,956 @@
+#include "system/Image.hpp"
+
+#include <array>
+#include <climits>
+
+/// Position of each coefficient of the zigzag order in the 8x8 block.
+static const uint8_t zigzag[64] = {
+	0, 1, 8, 16, 9, 2, 3, 10, 17, 24, 32, 25, 18, 11, 4, 5,
+	12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13, 6, 7, 14, 21, 28,
+	35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+	58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63
+};
+
+/// Reference quantization tables from the specification, for quality 50.
+static const uint8_t luminanceQuantization[64] = {
+	16, 11, 10, 16, 24, 40, 51, 61, 12, 12, 14, 19, 26, 58, 60, 55,
+	14, 13, 16, 24, 40, 57, 69, 56, 14, 17, 22, 29, 51, 87, 80, 62,
+	18, 22, 37, 56, 68, 109, 103, 77, 24, 35, 55, 64, 81, 104, 113, 92,
+	49, 64, 78, 87, 103, 121, 120, 101, 72, 92, 95, 98, 112, 100, 103, 99
+};
+
+static const uint8_t chrominanceQuantization[64] = {
+	17, 18, 24, 47, 99, 99, 99, 99, 18, 21, 26, 66, 99, 99, 99, 99,
+	24, 26, 56, 99, 99, 99, 99, 99, 47, 66, 99, 99, 99, 99, 99, 99,
+	99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99,
+	99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99, 99
+};
+
+struct JpegHuffman {
+	std::array<uint8_t, 17> counts = {}; ///< Number of codes of each length.
+	std::vector<uint8_t> symbols; ///< Symbols sorted by code length.
+	std::array<int32_t, 18> maxCode = {};
+	std::array<int32_t, 17> minCode = {};
+	std::array<int32_t, 17> valuePtr = {};
+	std::array<uint16_t, 256> codes = {}; ///< Code of each symbol, for encoding.
+	std::array<uint8_t, 256> sizes = {}; ///< Code length of each symbol, 0 if unused.
+
+	void build(){
+		int32_t code = 0;
+		int32_t index = 0;
+		sizes.fill(0);
+		for(int length = 1; length <= 16; ++length){
+			valuePtr[length] = index;
+			minCode[length] = code;
+			for(int i = 0; i < counts[length] && size_t(index + i) < symbols.size(); ++i){
+				codes[symbols[index + i]] = uint16_t(code + i);
+				sizes[symbols[index + i]] = uint8_t(length);
+			}
+			code += counts[length];
+			index += counts[length];
+			maxCode[length] = counts[length] != 0 ? code - 1 : -1;
+			code <<= 1;
+		}
+		maxCode[17] = INT32_MAX;
+	}
+};
+
+struct JpegComponent {
+	int id = 0;
+	int h = 1; ///< Horizontal sampling factor.
+	int v = 1; ///< Vertical sampling factor.
+	int quantTable = 0;
+	int dcTable = 0;
+	int acTable = 0;
+	int blocksW = 0; ///< Number of blocks per row, including padding to full MCUs.
+	int blocksH = 0; ///< Number of block rows, including padding to full MCUs.
+	int dcPred = 0;
+	std::vector<int16_t> coefs; ///< Quantized coefficients of each block, in natural order.
+};
+
+/// Content of a baseline JPEG file, as quantized DCT coefficients.
+struct JpegData {
+	int width = 0;
+	int height = 0;
+	int hMax = 1;
+	int vMax = 1;
+	int mcusX = 0;
+	int mcusY = 0;
+	int restartInterval = 0;
+	int adobeTransform = -1; ///< Color transform from the Adobe segment, if any.
+	std::array<std::array<uint16_t, 64>, 4> quant = {};
+	std::array<JpegHuffman, 4> dcTables;
+	std::array<JpegHuffman, 4> acTables;
+	std::vector<JpegComponent> components;
+	std::string exif; ///< Content of the EXIF segment, if any.
+	std::string profile; ///< ICC profile segments, markers included.
+
+	void allocate(){
+		for(const JpegComponent & comp : components){
+			hMax = (std::max)(hMax, comp.h);
+			vMax = (std::max)(vMax, comp.v);
+		}
+		mcusX = (width + 8 * hMax - 1) / (8 * hMax);
+		mcusY = (height + 8 * vMax - 1) / (8 * vMax);
+		for(JpegComponent & comp : components){
+			comp.blocksW = mcusX * comp.h;
+			comp.blocksH = mcusY * comp.v;
+			comp.coefs.assign(size_t(comp.blocksW) * comp.blocksH * 64, 0);
+		}
+	}
+
+	/// Size of a component in blocks, excluding padding.
+	void usedBlocks(const JpegComponent & comp, int & w, int & h) const {
+		const int compW = (width * comp.h + hMax - 1) / hMax;
+		const int compH = (height * comp.v + vMax - 1) / vMax;
+		w = (compW + 7) / 8;
+		h = (compH + 7) / 8;
+	}
+
+	/// Call a function for each block of a scan, in order.
+	void forEachBlock(const std::vector<int> & scanComps, const std::function<bool(int comp, int bx, int by)> & func, const std::function<bool()> & restart) const {
+		int mcuCount = 0;
+		const auto nextMcu = [this, &mcuCount, &restart](){
+			++mcuCount;
+			return restartInterval == 0 || mcuCount % restartInterval != 0 || restart();
+		};
+		// Non interleaved scans only cover the component itself.
+		if(scanComps.size() == 1){
+			int w = 0, h = 0;
+			usedBlocks(components[scanComps[0]], w, h);
+			for(int by = 0; by < h; ++by){
+				for(int bx = 0; bx < w; ++bx){
+					if(!func(scanComps[0], bx, by) || !nextMcu()){
+						return;
+					}
+				}
+			}
+			return;
+		}
+		for(int my = 0; my < mcusY; ++my){
+			for(int mx = 0; mx < mcusX; ++mx){
+				for(int cid : scanComps){
+					const JpegComponent & comp = components[cid];
+					for(int y = 0; y < comp.v; ++y){
+						for(int x = 0; x < comp.h; ++x){
+							if(!func(cid, mx * comp.h + x, my * comp.v + y)){
+								return;
+							}
+						}
+					}
+				}
+				if(!nextMcu()){
+					return;
+				}
+			}
+		}
+	}
+};
+
+class JpegBitReader {
+public:
+
+	JpegBitReader(const std::string & data, size_t pos) : _data(reinterpret_cast<const uint8_t*>(data.data())), _size(data.size()), _pos(pos) {}
+
+	int bit(){
+		if(_count == 0){
+			uint8_t byte = 0;
+			if(_pos < _size){
+				byte = _data[_pos];
+				if(byte != 0xFF){
+					++_pos;
+				} else if(_pos + 1 < _size && _data[_pos + 1] == 0x00){
+					// Stuffed byte.
+					_pos += 2;
+				} else {
+					// A marker, padded with zeros until the decoder reaches it.
+					byte = 0;
+				}
+			}
+			_buffer = byte;
+			_count = 8;
+		}
+		--_count;
+		return (_buffer >> _count) & 1;
+	}
+
+	int bits(int count){
+		int value = 0;
+		for(int i = 0; i < count; ++i){
+			value = (value << 1) | bit();
+		}
+		return value;
+	}
+
+	int decode(const JpegHuffman & table){
+		int32_t code = bit();
+		for(int length = 1; length <= 16; ++length){
+			if(code <= table.maxCode[length]){
+				const int32_t index = table.valuePtr[length] + code - table.minCode[length];
+				return size_t(index) < table.symbols.size() ? table.symbols[index] : -1;
+			}
+			code = (code << 1) | bit();
+		}
+		return -1;
+	}
+
+	/// Skip the restart marker and the remaining bits.
+	bool restart(){
+		_count = 0;
+		while(_pos + 1 < _size && _data[_pos] == 0xFF && _data[_pos + 1] == 0xFF){
+			++_pos;
+		}
+		if(_pos + 1 < _size && _data[_pos] == 0xFF && _data[_pos + 1] >= 0xD0 && _data[_pos + 1] <= 0xD7){
+			_pos += 2;
+			return true;
+		}
+		return false;
+	}
+
+	size_t position() const { return _pos; }
+
+private:
+	const uint8_t* _data;
+	size_t _size;
+	size_t _pos;
+	uint32_t _buffer = 0;
+	int _count = 0;
+};
+
+class JpegBitWriter {
+public:
+
+	explicit JpegBitWriter(std::string & data) : _data(data) {}
+
+	void write(uint32_t value, int count){
+		for(int i = count - 1; i >= 0; --i){
+			_buffer = (_buffer << 1) | ((value >> i) & 1);
+			if(++_count == 8){
+				_data.push_back(char(_buffer));
+				// Stuff a zero after each 0xFF so that it is not read as a marker.
+				if(_buffer == 0xFF){
+					_data.push_back(char(0));
+				}
+				_buffer = 0;
+				_count = 0;
+			}
+		}
+	}
+
+	void flush(){
+		// Pad with ones.
+		if(_count != 0){
+			write(0x7F, 8 - _count);
+		}
+	}
+
+private:
+	std::string & _data;
+	uint32_t _buffer = 0;
+	int _count = 0;
+};
+
+static int extend(int value, int size){
+	return value < (1 << (size - 1)) ? value - (1 << size) + 1 : value;
+}
+
+static int magnitudeSize(int value){
+	value = std::abs(value);
+	int size = 0;
+	while(value != 0){
+		++size;
+		value >>= 1;
+	}
+	return size;
+}
+
+static uint16_t readUint16(const std::string & data, size_t pos){
+	return uint16_t((uint8_t(data[pos]) << 8) | uint8_t(data[pos + 1]));
+}
+
+static void writeUint16(std::string & data, uint32_t value){
+	data.push_back(char((value >> 8) & 0xFF));
+	data.push_back(char(value & 0xFF));
+}
+
+static bool decodeScan(const std::string & data, size_t & pos, JpegData & jpeg, const std::vector<int> & scanComps){
+	JpegBitReader reader(data, pos);
+	for(JpegComponent & comp : jpeg.components){
+		comp.dcPred = 0;
+	}
+	bool valid = true;
+	jpeg.forEachBlock(scanComps, [&reader, &jpeg, &valid](int cid, int bx, int by){
+		JpegComponent & comp = jpeg.components[cid];
+		int16_t* block = &comp.coefs[(size_t(by) * comp.blocksW + bx) * 64];
+		const int dcSize = reader.decode(jpeg.dcTables[comp.dcTable]);
+		if(dcSize < 0 || dcSize > 11){
+			valid = false;
+			return false;
+		}
+		comp.dcPred += dcSize != 0 ? extend(reader.bits(dcSize), dcSize) : 0;
+		block[0] = int16_t(comp.dcPred);
+		for(int k = 1; k < 64;){
+			const int symbol = reader.decode(jpeg.acTables[comp.acTable]);
+			if(symbol < 0){
+				valid = false;
+				return false;
+			}
+			const int run = symbol >> 4;
+			const int size = symbol & 15;
+			if(size == 0){
+				if(run != 15){
+					break;
+				}
+				k += 16;
+				continue;
+			}
+			k += run;
+			if(k > 63){
+				valid = false;
+				return false;
+			}
+			block[zigzag[k]] = int16_t(extend(reader.bits(size), size));
+			++k;
+		}
+		return true;
+	}, [&reader, &jpeg](){
+		for(JpegComponent & comp : jpeg.components){
+			comp.dcPred = 0;
+		}
+		return reader.restart();
+	});
+	pos = reader.position();
+	return valid;
+}
+
+/// Parse a baseline JPEG file into its coefficients.
+static bool parseJpeg(const std::string & data, JpegData & jpeg){
+	size_t pos = 2;
+	bool hasFrame = false;
+	bool hasScan = false;
+	while(pos + 4 <= data.size()){
+		if(uint8_t(data[pos]) != 0xFF){
+			// Garbage between segments.
+			++pos;
+			continue;
+		}
+		const uint8_t marker = uint8_t(data[pos + 1]);
+		if(marker == 0xFF || marker == 0x00 || (marker >= 0xD0 && marker <= 0xD7) || marker == 0x01){
+			++pos;
+			continue;
+		}
+		if(marker == 0xD9){
+			break;
+		}
+		const size_t length = readUint16(data, pos + 2);
+		const size_t start = pos + 4;
+		const size_t end = pos + 2 + length;
+		if(length < 2 || end > data.size()){
+			return false;
+		}
+		if(marker == 0xC0 || marker == 0xC1){
+			if(length < 8 || uint8_t(data[start]) != 8){
+				return false;
+			}
+			jpeg.height = readUint16(data, start + 1);
+			jpeg.width = readUint16(data, start + 3);
+			const size_t count = uint8_t(data[start + 5]);
+			if(jpeg.width == 0 || jpeg.height == 0 || count == 0 || count > 4 || length < 8 + 3 * count){
+				return false;
+			}
+			jpeg.components.resize(count);
+			for(size_t cid = 0; cid < count; ++cid){
+				JpegComponent & comp = jpeg.components[cid];
+				comp.id = uint8_t(data[start + 6 + 3 * cid]);
+				comp.h = uint8_t(data[start + 7 + 3 * cid]) >> 4;
+				comp.v = uint8_t(data[start + 7 + 3 * cid]) & 15;
+				comp.quantTable = uint8_t(data[start + 8 + 3 * cid]) & 3;
+				if(comp.h < 1 || comp.h > 4 || comp.v < 1 || comp.v > 4){
+					return false;
+				}
+			}
+			jpeg.allocate();
+			hasFrame = true;
+		} else if(marker >= 0xC2 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC){
+			// Progressive, lossless and arithmetic coding are not supported.
+			return false;
+		} else if(marker == 0xC4){
+			size_t tpos = start;
+			while(tpos + 17 <= end){
+				const uint8_t info = uint8_t(data[tpos]);
+				JpegHuffman & table = (info >> 4) == 0 ? jpeg.dcTables[info & 3] : jpeg.acTables[info & 3];
+				size_t total = 0;
+				for(int i = 1; i <= 16; ++i){
+					table.counts[i] = uint8_t(data[tpos + i]);
+					total += table.counts[i];
+				}
+				if(tpos + 17 + total > end){
+					return false;
+				}
+				table.symbols.assign(data.begin() + tpos + 17, data.begin() + tpos + 17 + total);
+				table.build();
+				tpos += 17 + total;
+			}
+		} else if(marker == 0xDB){
+			size_t tpos = start;
+			while(tpos < end){
+				const uint8_t info = uint8_t(data[tpos]);
+				const bool wide = (info >> 4) != 0;
+				if(tpos + 1 + (wide ? 128 : 64) > end){
+					return false;
+				}
+				for(int k = 0; k < 64; ++k){
+					jpeg.quant[info & 3][zigzag[k]] = wide ? readUint16(data, tpos + 1 + 2 * k) : uint8_t(data[tpos + 1 + k]);
+				}
+				tpos += 1 + (wide ? 128 : 64);
+			}
+		} else if(marker == 0xE1 && jpeg.exif.empty() && data.compare(start, 6, std::string("Exif\0\0", 6)) == 0){
+			jpeg.exif.assign(data, start, end - start);
+		} else if(marker == 0xE2 && length >= 16 && data.compare(start, 12, std::string("ICC_PROFILE\0", 12)) == 0){
+			jpeg.profile.append(data, pos, end - pos);
+		} else if(marker == 0xEE && length >= 14 && data.compare(start, 5, "Adobe") == 0){
+			jpeg.adobeTransform = uint8_t(data[start + 11]);
+		} else if(marker == 0xDD){
+			jpeg.restartInterval = readUint16(data, start);
+		} else if(marker == 0xDA){
+			if(!hasFrame){
+				return false;
+			}
+			const size_t count = uint8_t(data[start]);
+			std::vector<int> scanComps;
+			for(size_t sid = 0; sid < count; ++sid){
+				const int id = uint8_t(data[start + 1 + 2 * sid]);
+				const uint8_t tables = uint8_t(data[start + 2 + 2 * sid]);
+				for(size_t cid = 0; cid < jpeg.components.size(); ++cid){
+					if(jpeg.components[cid].id == id){
+						jpeg.components[cid].dcTable = tables >> 4 & 3;
+						jpeg.components[cid].acTable = tables & 3;
+						scanComps.push_back(int(cid));
+					}
+				}
+			}
+			if(scanComps.empty()){
+				return false;
+			}
+			pos = end;
+			if(!decodeScan(data, pos, jpeg, scanComps)){
+				return false;
+			}
+			hasScan = true;
+			continue;
+		}
+		pos = end;
+	}
+	return hasFrame && hasScan;
+}
+
+/// Build the Huffman table minimizing the size of the encoded symbols, limited to 16 bits per code.
+static void buildOptimalTable(const std::array<uint32_t, 256> & frequencies, JpegHuffman & table){
+	std::array<int64_t, 257> freq;
+	std::array<int, 257> codeSize;
+	std::array<int, 257> others;
+	for(int i = 0; i < 256; ++i){
+		freq[i] = frequencies[i];
+	}
+	// Reserved symbol so that no code is made only of ones.
+	freq[256] = 1;
+	codeSize.fill(0);
+	others.fill(-1);
+	while(true){
+		int c1 = -1;
+		int c2 = -1;
+		for(int i = 0; i <= 256; ++i){
+			if(freq[i] != 0 && (c1 < 0 || freq[i] <= freq[c1])){
+				c1 = i;
+			}
+		}
+		for(int i = 0; i <= 256; ++i){
+			if(freq[i] != 0 && i != c1 && (c2 < 0 || freq[i] <= freq[c2])){
+				c2 = i;
+			}
+		}
+		if(c2 < 0){
+			break;
+		}
+		freq[c1] += freq[c2];
+		freq[c2] = 0;
+		++codeSize[c1];
+		while(others[c1] >= 0){
+			c1 = others[c1];
+			++codeSize[c1];
+		}
+		others[c1] = c2;
+		++codeSize[c2];
+		while(others[c2] >= 0){
+			c2 = others[c2];
+			++codeSize[c2];
+		}
+	}
+	std::array<int, 33> bits = {};
+	for(int i = 0; i <= 256; ++i){
+		if(codeSize[i] != 0){
+			++bits[(std::min)(codeSize[i], 32)];
+		}
+	}
+	for(int i = 32; i > 16; --i){
+		while(bits[i] > 0){
+			int j = i - 2;
+			while(bits[j] == 0){
+				--j;
+			}
+			bits[i] -= 2;
+			++bits[i - 1];
+			bits[j + 1] += 2;
+			--bits[j];
+		}
+	}
+	// Remove the reserved symbol.
+	int last = 16;
+	while(last > 0 && bits[last] == 0){
+		--last;
+	}
+	if(last > 0){
+		--bits[last];
+	}
+	table.symbols.clear();
+	for(int i = 1; i <= 16; ++i){
+		table.counts[i] = uint8_t(bits[i]);
+	}
+	for(int size = 1; size <= 32; ++size){
+		for(int i = 0; i < 256; ++i){
+			if(codeSize[i] == size){
+				table.symbols.push_back(uint8_t(i));
+			}
+		}
+	}
+	table.build();
+}
+
+/// JFIF header, without density information.
+static const std::string jfifSegment("\xFF\xE0\x00\x10JFIF\x00\x01\x01\x00\x00\x01\x00\x01\x00\x00", 18);
+
+/// Write the coefficients as a baseline JPEG file, with Huffman tables optimized for the content. Header segments are written as-is after the start marker.
+static void writeJpeg(JpegData & jpeg, const std::string & headerSegments, std::string & data){
+	// Luminance and chrominance use separate tables.
+	std::vector<int> scanComps;
+	for(size_t cid = 0; cid < jpeg.components.size(); ++cid){
+		jpeg.components[cid].dcTable = cid == 0 ? 0 : 1;
+		jpeg.components[cid].acTable = cid == 0 ? 0 : 1;
+		scanComps.push_back(int(cid));
+	}
+	jpeg.restartInterval = 0;
+	const size_t tableCount = jpeg.components.size() > 1 ? 2 : 1;
+
+	// Encode all blocks, either to gather statistics or to write them.
+	const auto encode = [&jpeg, &scanComps](const std::function<void(int table, bool ac, int symbol, int value, int size)> & emit){
+		for(JpegComponent & comp : jpeg.components){
+			comp.dcPred = 0;
+		}
+		jpeg.forEachBlock(scanComps, [&jpeg, &emit](int cid, int bx, int by){
+			JpegComponent & comp = jpeg.components[cid];
+			const int16_t* block = &comp.coefs[(size_t(by) * comp.blocksW + bx) * 64];
+			const int diff = block[0] - comp.dcPred;
+			comp.dcPred = block[0];
+			const int dcSize = magnitudeSize(diff);
+			emit(comp.dcTable, false, dcSize, diff, dcSize);
+			int run = 0;
+			for(int k = 1; k < 64; ++k){
+				const int value = block[zigzag[k]];
+				if(value == 0){
+					++run;
+					continue;
+				}
+				while(run > 15){
+					emit(comp.acTable, true, 0xF0, 0, 0);
+					run -= 16;
+				}
+				const int size = magnitudeSize(value);
+				emit(comp.acTable, true, (run << 4) | size, value, size);
+				run = 0;
+			}
+			if(run > 0){
+				emit(comp.acTable, true, 0x00, 0, 0);
+			}
+			return true;
+		}, [](){ return true; });
+	};
+
+	std::array<std::array<uint32_t, 256>, 4> frequencies = {};
+	encode([&frequencies](int table, bool ac, int symbol, int, int){
+		++frequencies[table * 2 + (ac ? 1 : 0)][symbol];
+	});
+	for(size_t tid = 0; tid < tableCount; ++tid){
+		buildOptimalTable(frequencies[tid * 2], jpeg.dcTables[tid]);
+		buildOptimalTable(frequencies[tid * 2 + 1], jpeg.acTables[tid]);
+	}
+
+	data.assign("\xFF\xD8", 2);
+	data.append(headerSegments);
+
+	bool wideTables = false;
+	std::array<bool, 4> usedTables = {};
+	for(const JpegComponent & comp : jpeg.components){
+		usedTables[comp.quantTable] = true;
+	}
+	for(int tid = 0; tid < 4; ++tid){
+		if(!usedTables[tid]){
+			continue;
+		}
+		bool wide = false;
+		for(int k = 0; k < 64; ++k){
+			wide = wide || jpeg.quant[tid][k] > 255;
+		}
+		wideTables = wideTables || wide;
+		data.append("\xFF\xDB", 2);
+		writeUint16(data, 2 + 1 + (wide ? 128 : 64));
+		data.push_back(char((wide ? 0x10 : 0x00) | tid));
+		for(int k = 0; k < 64; ++k){
+			const uint16_t value = jpeg.quant[tid][zigzag[k]];
+			if(wide){
+				writeUint16(data, value);
+			} else {
+				data.push_back(char(value));
+			}
+		}
+	}
+
+	// Baseline frames only support 8 bits quantization tables.
+	data.append(wideTables ? "\xFF\xC1" : "\xFF\xC0", 2);
+	writeUint16(data, uint32_t(8 + 3 * jpeg.components.size()));
+	data.push_back(char(8));
+	writeUint16(data, uint32_t(jpeg.height));
+	writeUint16(data, uint32_t(jpeg.width));
+	data.push_back(char(jpeg.components.size()));
+	for(const JpegComponent & comp : jpeg.components){
+		data.push_back(char(comp.id));
+		data.push_back(char((comp.h << 4) | comp.v));
+		data.push_back(char(comp.quantTable));
+	}
+
+	for(size_t tid = 0; tid < tableCount; ++tid){
+		for(int ac = 0; ac < 2; ++ac){
+			const JpegHuffman & table = ac ? jpeg.acTables[tid] : jpeg.dcTables[tid];
+			data.append("\xFF\xC4", 2);
+			writeUint16(data, uint32_t(2 + 17 + table.symbols.size()));
+			data.push_back(char((ac << 4) | int(tid)));
+			for(int i = 1; i <= 16; ++i){
+				data.push_back(char(table.counts[i]));
+			}
+			data.append(table.symbols.begin(), table.symbols.end());
+		}
+	}
+
+	data.append("\xFF\xDA", 2);
+	writeUint16(data, uint32_t(6 + 2 * jpeg.components.size()));
+	data.push_back(char(jpeg.components.size()));
+	for(const JpegComponent & comp : jpeg.components){
+		data.push_back(char(comp.id));
+		data.push_back(char((comp.dcTable << 4) | comp.acTable));
+	}
+	data.append("\x00\x3F\x00", 3);
+
+	JpegBitWriter writer(data);
+	encode([&jpeg, &writer](int table, bool ac, int symbol, int value, int size){
+		const JpegHuffman & huffman = ac ? jpeg.acTables[table] : jpeg.dcTables[table];
+		writer.write(huffman.codes[symbol], huffman.sizes[symbol]);
+		if(size != 0){
+			writer.write(uint32_t(value < 0 ? value + (1 << size) - 1 : value), size);
+		}
+	});
+	writer.flush();
+	data.append("\xFF\xD9", 2);
+}
+
+/// Orthonormal DCT basis, cosines[x][u].
+static const std::array<std::array<float, 8>, 8> & dctBasis(){
+	static const std::array<std::array<float, 8>, 8> basis = [](){
+		std::array<std::array<float, 8>, 8> res;
+		for(int x = 0; x < 8; ++x){
+			for(int u = 0; u < 8; ++u){
+				const double scale = u == 0 ? std::sqrt(0.125) : 0.5;
+				res[x][u] = float(scale * std::cos(double(2 * x + 1) * double(u) * 3.14159265358979323846 / 16.0));
+			}
+		}
+		return res;
+	}();
+	return basis;
+}
+
+bool Image::decodeJpeg(const std::string & data){
+	JpegData jpeg;
+	if(!parseJpeg(data, jpeg)){
+		return false;
+	}
+	// Only grayscale and YCbCr images are supported.
+	if(jpeg.components.size() != 1 && jpeg.components.size() != 3){
+		return false;
+	}
+	const auto & basis = dctBasis();
+
+	// Reconstruct each component at its own resolution.
+	std::vector<std::vector<uint8_t>> planes(jpeg.components.size());
+	for(size_t cid = 0; cid < jpeg.components.size(); ++cid){
+		const JpegComponent & comp = jpeg.components[cid];
+		const size_t planeW = size_t(comp.blocksW) * 8;
+		planes[cid].resize(planeW * size_t(comp.blocksH) * 8);
+		const std::array<uint16_t, 64> & quant = jpeg.quant[comp.quantTable];
+		for(int by = 0; by < comp.blocksH; ++by){
+			for(int bx = 0; bx < comp.blocksW; ++bx){
+				const int16_t* block = &comp.coefs[(size_t(by) * comp.blocksW + bx) * 64];
+				float rows[64];
+				for(int v = 0; v < 8; ++v){
+					for(int x = 0; x < 8; ++x){
+						float sum = 0.0f;
+						for(int u = 0; u < 8; ++u){
+							sum += basis[x][u] * float(block[v * 8 + u] * quant[v * 8 + u]);
+						}
+						rows[v * 8 + x] = sum;
+					}
+				}
+				for(int y = 0; y < 8; ++y){
+					uint8_t* dst = &planes[cid][(size_t(by) * 8 + y) * planeW + size_t(bx) * 8];
+					for(int x = 0; x < 8; ++x){
+						float sum = 0.0f;
+						for(int v = 0; v < 8; ++v){
+							sum += basis[y][v] * rows[v * 8 + x];
+						}
+						dst[x] = uint8_t((std::min)((std::max)(std::lround(sum + 128.0f), 0l), 255l));
+					}
+				}
+			}
+		}
+	}
+
+	// Components are usually YCbCr, unless specified otherwise.
+	const std::vector<JpegComponent> & comps = jpeg.components;
+	const bool isRgb = jpeg.adobeTransform == 0 || (comps.size() == 3 && comps[0].id == 'R' && comps[1].id == 'G' && comps[2].id == 'B');
+
+	_width = unsigned(jpeg.width);
+	_height = unsigned(jpeg.height);
+	_channels = jpeg.components.size() == 1 ? 1 : 3;
+	_pixels.resize(size_t(_width) * _height * _channels);
+	for(unsigned int y = 0; y < _height; ++y){
+		for(unsigned int x = 0; x < _width; ++x){
+			float values[3];
+			for(size_t cid = 0; cid < jpeg.components.size(); ++cid){
+				const JpegComponent & comp = jpeg.components[cid];
+				const size_t sx = size_t(x) * comp.h / jpeg.hMax;
+				const size_t sy = size_t(y) * comp.v / jpeg.vMax;
+				values[cid] = float(planes[cid][sy * size_t(comp.blocksW) * 8 + sx]);
+			}
+			uint8_t* dst = &_pixels[(size_t(y) * _width + x) * _channels];
+			if(_channels == 1 || isRgb){
+				for(unsigned int c = 0; c < _channels; ++c){
+					dst[c] = uint8_t(values[c]);
+				}
+				continue;
+			}
+			const float cb = values[1] - 128.0f;
+			const float cr = values[2] - 128.0f;
+			const float rgb[3] = { values[0] + 1.402f * cr, values[0] - 0.344136f * cb - 0.714136f * cr, values[0] + 1.772f * cb };
+			for(int c = 0; c < 3; ++c){
+				dst[c] = uint8_t((std::min)((std::max)(std::lround(rgb[c]), 0l), 255l));
+			}
+		}
+	}
+	// Pixels are stored as displayed, the color profile is kept for encoding.
+	orient(exifOrientation(jpeg.exif, 0, jpeg.exif.size()));
+	_profile = jpeg.profile;
+	return true;
+}
+
+bool Image::encodeJpeg(std::string & data, int quality) const {
+	if(_channels == 0 || _channels > 4){
+		return false;
+	}
+	// Color images use 4:2:0 chroma subsampling, alpha is ignored.
+	const bool color = _channels >= 3;
+	JpegData jpeg;
+	jpeg.width = int(_width);
+	jpeg.height = int(_height);
+	jpeg.components.resize(color ? 3 : 1);
+	for(size_t cid = 0; cid < jpeg.components.size(); ++cid){
+		JpegComponent & comp = jpeg.components[cid];
+		comp.id = int(cid) + 1;
+		comp.h = (color && cid == 0) ? 2 : 1;
+		comp.v = comp.h;
+		comp.quantTable = cid == 0 ? 0 : 1;
+	}
+	jpeg.allocate();
+
+	quality = (std::min)((std::max)(quality, 1), 100);
+	const int scale = quality < 50 ? 5000 / quality : 200 - 2 * quality;
+	for(int k = 0; k < 64; ++k){
+		jpeg.quant[0][k] = uint16_t((std::min)((std::max)((luminanceQuantization[k] * scale + 50) / 100, 1), 255));
+		jpeg.quant[1][k] = uint16_t((std::min)((std::max)((chrominanceQuantization[k] * scale + 50) / 100, 1), 255));
+	}
+
+	// Convert to YCbCr, with edge pixels repeated in the padding.
+	const size_t fullW = size_t(jpeg.mcusX) * jpeg.hMax * 8;
+	const size_t fullH = size_t(jpeg.mcusY) * jpeg.vMax * 8;
+	std::vector<std::vector<float>> planes(jpeg.components.size(), std::vector<float>(fullW * fullH));
+	for(size_t y = 0; y < fullH; ++y){
+		for(size_t x = 0; x < fullW; ++x){
+			const uint8_t* src = &_pixels[((std::min)(y, size_t(_height) - 1) * _width + (std::min)(x, size_t(_width) - 1)) * _channels];
+			const size_t index = y * fullW + x;
+			if(!color){
+				planes[0][index] = float(src[0]);
+				continue;
+			}
+			const float r = float(src[0]);
+			const float g = float(src[1]);
+			const float b = float(src[2]);
+			planes[0][index] = 0.299f * r + 0.587f * g + 0.114f * b;
+			planes[1][index] = -0.168736f * r - 0.331264f * g + 0.5f * b + 128.0f;
+			planes[2][index] = 0.5f * r - 0.418688f * g - 0.081312f * b + 128.0f;
+		}
+	}
+
+	const auto & basis = dctBasis();
+	for(JpegComponent & comp : jpeg.components){
+		const size_t cid = size_t(&comp - &jpeg.components[0]);
+		const std::vector<float> & plane = planes[cid];
+		const int factorX = jpeg.hMax / comp.h;
+		const int factorY = jpeg.vMax / comp.v;
+		const std::array<uint16_t, 64> & quant = jpeg.quant[comp.quantTable];
+		for(int by = 0; by < comp.blocksH; ++by){
+			for(int bx = 0; bx < comp.blocksW; ++bx){
+				// Average the covered pixels for subsampled components.
+				float samples[64];
+				for(int y = 0; y < 8; ++y){
+					for(int x = 0; x < 8; ++x){
+						float sum = 0.0f;
+						for(int sy = 0; sy < factorY; ++sy){
+							for(int sx = 0; sx < factorX; ++sx){
+								sum += plane[(size_t(by * 8 + y) * factorY + sy) * fullW + size_t(bx * 8 + x) * factorX + sx];
+							}
+						}
+						samples[y * 8 + x] = sum / float(factorX * factorY) - 128.0f;
+					}
+				}
+				float rows[64];
+				for(int y = 0; y < 8; ++y){
+					for(int u = 0; u < 8; ++u){
+						float sum = 0.0f;
+						for(int x = 0; x < 8; ++x){
+							sum += basis[x][u] * samples[y * 8 + x];
+						}
+						rows[y * 8 + u] = sum;
+					}
+				}
+				int16_t* block = &comp.coefs[(size_t(by) * comp.blocksW + bx) * 64];
+				for(int v = 0; v < 8; ++v){
+					for(int u = 0; u < 8; ++u){
+						float sum = 0.0f;
+						for(int y = 0; y < 8; ++y){
+							sum += basis[y][v] * rows[y * 8 + u];
+						}
+						block[v * 8 + u] = int16_t(std::lround(sum / float(quant[v * 8 + u])));
+					}
+				}
+			}
+		}
+	}
+	writeJpeg(jpeg, jfifSegment + _profile, data);
+	return true;
+}
+
+int Image::exifOrientation(const std::string & data, size_t start, size_t end){
+	const size_t tiff = start + 6;
+	if(end < tiff + 8 || data.compare(start, 6, std::string("Exif\0\0", 6)) != 0){
+		return 1;
+	}
+	const bool little = data[tiff] == 'I';
+	const auto read = [&data, little](size_t pos, int size){
+		uint32_t value = 0;
+		for(int i = 0; i < size; ++i){
+			const uint32_t byte = uint8_t(data[pos + (little ? size - 1 - i : i)]);
+			value = (value << 8) | byte;
+		}
+		return value;
+	};
+	const size_t ifd = tiff + read(tiff + 4, 4);
+	if(ifd + 2 > end || ifd < tiff){
+		return 1;
+	}
+	const size_t count = read(ifd, 2);
+	for(size_t eid = 0; eid < count && ifd + 2 + 12 * (eid + 1) <= end; ++eid){
+		const size_t entry = ifd + 2 + 12 * eid;
+		if(read(entry, 2) == 0x0112){
+			return int(read(entry + 8, 2));
+		}
+	}
+	return 1;
+}
+
+bool Image::optimizeJpeg(const std::string & src, std::string & dst){
+	// Keep segments that affect how the image is displayed: JFIF and Adobe headers, color profiles and the orientation.
+	std::string headerSegments;
+	std::string otherSegments;
+	size_t pos = 2;
+	size_t scanStart = 0;
+	while(pos + 4 <= src.size()){
+		if(uint8_t(src[pos]) != 0xFF){
+			return false;
+		}
+		const uint8_t marker = uint8_t(src[pos + 1]);
+		if(marker == 0xFF){
+			++pos;
+			continue;
+		}
+		const size_t length = readUint16(src, pos + 2);
+		const size_t start = pos + 4;
+		const size_t end = pos + 2 + length;
+		if(length < 2 || end > src.size()){
+			return false;
+		}
+		if(marker == 0xDA){
+			scanStart = pos;
+			break;
+		}
+		const bool isJfif = marker == 0xE0 && src.compare(start, 5, std::string("JFIF\0", 5)) == 0;
+		const bool isProfile = marker == 0xE2 && src.compare(start, 12, std::string("ICC_PROFILE\0", 12)) == 0;
+		const bool isAdobe = marker == 0xEE && src.compare(start, 5, "Adobe") == 0;
+		if(isJfif || isProfile || isAdobe){
+			headerSegments.append(src, pos, end - pos);
+		} else if(marker == 0xE1){
+			const int orientation = exifOrientation(src, start, end);
+			if(orientation > 1 && orientation <= 8){
+				// Minimal EXIF segment with a single orientation entry.
+				headerSegments.append("\xFF\xE1\x00\x22" "Exif\x00\x00" "MM\x00\x2A\x00\x00\x00\x08" "\x00\x01\x01\x12\x00\x03\x00\x00\x00\x01\x00", 29);
+				headerSegments.push_back(char(orientation));
+				headerSegments.append(6, '\0');
+			}
+		} else if(!(marker >= 0xE0 && marker <= 0xEF) && marker != 0xFE){
+			otherSegments.append(src, pos, end - pos);
+		}
+		pos = end;
+	}
+	if(scanStart == 0){
+		return false;
+	}
+
+	// Remove metadata, the coded data is unchanged.
+	dst.assign("\xFF\xD8", 2);
+	dst.append(headerSegments);
+	dst.append(otherSegments);
+	dst.append(src, scanStart, std::string::npos);
+
+	// Baseline images can also be encoded again with optimized tables, the coefficients are unchanged.
+	JpegData jpeg;
+	if(!parseJpeg(src, jpeg)){
+		return true;
+	}
+	int blocksPerMcu = 0;
+	for(const JpegComponent & comp : jpeg.components){
+		blocksPerMcu += comp.h * comp.v;
+	}
+	if(jpeg.components.size() == 1 || blocksPerMcu <= 10){
+		std::string encoded;
+		writeJpeg(jpeg, headerSegments, encoded);
+		if(encoded.size() < dst.size()){
+			dst.swap(encoded);
+		}
+	}
+	return true;
+}
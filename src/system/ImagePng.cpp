@@ -0,0 +1,366 @@
+#include "system/Image.hpp"
+
+#include <cstring>
+
+#ifndef _WIN32
+#include <zlib.h>
+#endif
+
+#ifdef _WIN32
+
+bool Image::decodePng(const std::string &){
+	return false;
+}
+
+bool Image::encodePng(std::string &) const {
+	return false;
+}
+
+bool Image::optimizePng(const std::string &, std::string &){
+	return false;
+}
+
+#else
+
+static uint32_t readUint32(const uint8_t* data){
+	return (uint32_t(data[0]) << 24) | (uint32_t(data[1]) << 16) | (uint32_t(data[2]) << 8) | uint32_t(data[3]);
+}
+
+static void writeUint32(std::string & data, uint32_t value){
+	data.push_back(char((value >> 24) & 0xFF));
+	data.push_back(char((value >> 16) & 0xFF));
+	data.push_back(char((value >> 8) & 0xFF));
+	data.push_back(char(value & 0xFF));
+}
+
+static uint8_t paeth(int a, int b, int c){
+	const int p = a + b - c;
+	const int pa = std::abs(p - a);
+	const int pb = std::abs(p - b);
+	const int pc = std::abs(p - c);
+	if(pa <= pb && pa <= pc){
+		return uint8_t(a);
+	}
+	return uint8_t(pb <= pc ? b : c);
+}
+
+/// Apply or revert one of the five PNG filters on a row.
+static void filterRow(uint8_t type, const uint8_t* row, const uint8_t* prev, size_t size, size_t bpp, bool revert, uint8_t* dst){
+	for(size_t i = 0; i < size; ++i){
+		// Neighbors are the unfiltered values.
+		const int a = i >= bpp ? (revert ? dst[i - bpp] : row[i - bpp]) : 0;
+		const int b = prev ? prev[i] : 0;
+		const int c = (i >= bpp && prev) ? prev[i - bpp] : 0;
+		int predictor = 0;
+		switch(type){
+			case 1: predictor = a; break;
+			case 2: predictor = b; break;
+			case 3: predictor = (a + b) / 2; break;
+			case 4: predictor = paeth(a, b, c); break;
+			default: break;
+		}
+		dst[i] = revert ? uint8_t(row[i] + predictor) : uint8_t(row[i] - predictor);
+	}
+}
+
+static void writeChunk(std::string & data, const char* type, const uint8_t* content, size_t size){
+	writeUint32(data, uint32_t(size));
+	const size_t start = data.size();
+	data.append(type, 4);
+	if(size != 0){
+		data.append(reinterpret_cast<const char*>(content), size);
+	}
+	writeUint32(data, uint32_t(crc32(0, reinterpret_cast<const Bytef*>(data.data() + start), uInt(size + 4))));
+}
+
+/// Filter each row with the filter that minimizes the sum of absolute differences, a good estimate of how well it compresses.
+static void filterRows(const uint8_t* rows, size_t rowSize, size_t height, size_t bpp, bool adaptive, std::vector<uint8_t> & raw){
+	raw.resize((rowSize + 1) * height);
+	std::vector<uint8_t> candidate(rowSize);
+	for(size_t y = 0; y < height; ++y){
+		const uint8_t* row = rows + y * rowSize;
+		const uint8_t* prev = y > 0 ? rows + (y - 1) * rowSize : nullptr;
+		uint8_t* dst = &raw[y * (rowSize + 1)];
+		uint64_t bestScore = UINT64_MAX;
+		for(uint8_t type = 0; type < (adaptive ? 5 : 1); ++type){
+			filterRow(type, row, prev, rowSize, bpp, false, candidate.data());
+			uint64_t score = 0;
+			for(size_t i = 0; i < rowSize && score < bestScore; ++i){
+				score += uint64_t(std::abs(int(int8_t(candidate[i]))));
+			}
+			if(score < bestScore){
+				bestScore = score;
+				dst[0] = type;
+				std::memcpy(dst + 1, candidate.data(), rowSize);
+			}
+		}
+	}
+}
+
+/// Compress with the given strategy at the highest level.
+static bool deflateData(const std::vector<uint8_t> & raw, int strategy, std::string & compressed){
+	z_stream stream;
+	std::memset(&stream, 0, sizeof(stream));
+	if(deflateInit2(&stream, Z_BEST_COMPRESSION, Z_DEFLATED, 15, 9, strategy) != Z_OK){
+		return false;
+	}
+	compressed.resize(deflateBound(&stream, uLong(raw.size())));
+	stream.next_in = const_cast<Bytef*>(raw.data());
+	stream.avail_in = uInt(raw.size());
+	stream.next_out = reinterpret_cast<Bytef*>(&compressed[0]);
+	stream.avail_out = uInt(compressed.size());
+	const int status = deflate(&stream, Z_FINISH);
+	compressed.resize(stream.total_out);
+	deflateEnd(&stream);
+	return status == Z_STREAM_END;
+}
+
+/// Decompress data of unknown size.
+static bool inflateData(const std::string & compressed, std::vector<uint8_t> & raw){
+	z_stream stream;
+	std::memset(&stream, 0, sizeof(stream));
+	if(inflateInit(&stream) != Z_OK){
+		return false;
+	}
+	stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(compressed.data()));
+	stream.avail_in = uInt(compressed.size());
+	raw.clear();
+	uint8_t buffer[65536];
+	int status = Z_OK;
+	while(status == Z_OK){
+		stream.next_out = buffer;
+		stream.avail_out = sizeof(buffer);
+		status = inflate(&stream, Z_NO_FLUSH);
+		raw.insert(raw.end(), buffer, buffer + (sizeof(buffer) - stream.avail_out));
+	}
+	inflateEnd(&stream);
+	return status == Z_STREAM_END;
+}
+
+bool Image::decodePng(const std::string & data){
+	const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data.data());
+	size_t pos = 8;
+	uint32_t width = 0, height = 0;
+	uint8_t depth = 0, colorType = 0, interlace = 0;
+	std::vector<uint8_t> palette;
+	std::vector<uint8_t> paletteAlpha;
+	std::vector<unsigned int> transparentColor;
+	std::string compressed;
+	while(pos + 12 <= data.size()){
+		const uint32_t length = readUint32(bytes + pos);
+		const std::string type = data.substr(pos + 4, 4);
+		const uint8_t* chunk = bytes + pos + 8;
+		if(length > data.size() - pos - 12){
+			return false;
+		}
+		if(type == "IHDR" && length >= 13){
+			width = readUint32(chunk);
+			height = readUint32(chunk + 4);
+			depth = chunk[8];
+			colorType = chunk[9];
+			interlace = chunk[12];
+		} else if(type == "PLTE"){
+			palette.assign(chunk, chunk + length);
+		} else if(type == "tRNS" && colorType == 3){
+			paletteAlpha.assign(chunk, chunk + length);
+		} else if(type == "tRNS" && (colorType == 0 || colorType == 2)){
+			// A single color is transparent.
+			transparentColor.clear();
+			for(uint32_t i = 0; i + 1 < length; i += 2){
+				transparentColor.push_back((unsigned(chunk[i]) << 8) | chunk[i + 1]);
+			}
+		} else if(type == "IDAT"){
+			compressed.append(data, pos + 8, length);
+		} else if(type == "IEND"){
+			break;
+		}
+		pos += 12 + length;
+	}
+
+	static const unsigned int channelCounts[7] = { 1, 0, 3, 1, 2, 0, 4 };
+	if(width == 0 || height == 0 || colorType > 6 || channelCounts[colorType] == 0 || interlace != 0){
+		return false;
+	}
+	if(!(depth == 8 || depth == 16 || (depth < 8 && (colorType == 0 || colorType == 3)))){
+		return false;
+	}
+	const unsigned int srcChannels = channelCounts[colorType];
+	const size_t rowSize = (size_t(width) * srcChannels * depth + 7) / 8;
+	const size_t bpp = (std::max)(size_t(1), size_t(srcChannels * depth / 8));
+
+	uLongf rawSize = uLongf((rowSize + 1) * height);
+	std::vector<uint8_t> raw(rawSize);
+	if(uncompress(raw.data(), &rawSize, reinterpret_cast<const Bytef*>(compressed.data()), uLong(compressed.size())) != Z_OK || rawSize != raw.size()){
+		return false;
+	}
+
+	// Revert filters.
+	std::vector<uint8_t> rows(rowSize * height);
+	for(uint32_t y = 0; y < height; ++y){
+		const uint8_t* row = &raw[y * (rowSize + 1)];
+		if(row[0] > 4){
+			return false;
+		}
+		filterRow(row[0], row + 1, y > 0 ? &rows[(y - 1) * rowSize] : nullptr, rowSize, bpp, true, &rows[y * rowSize]);
+	}
+
+	// Convert to 8 bits per channel, palettes and transparent colors are expanded.
+	const bool isPalette = colorType == 3;
+	const bool hasKey = !transparentColor.empty() && transparentColor.size() == srcChannels;
+	_width = width;
+	_height = height;
+	_channels = isPalette ? (paletteAlpha.empty() ? 3 : 4) : (srcChannels + (hasKey ? 1 : 0));
+	_pixels.resize(size_t(_width) * _height * _channels);
+	const unsigned int maxValue = (1u << depth) - 1;
+	unsigned int values[4];
+	for(uint32_t y = 0; y < height; ++y){
+		const uint8_t* row = &rows[y * rowSize];
+		for(uint32_t x = 0; x < width; ++x){
+			for(unsigned int c = 0; c < srcChannels; ++c){
+				const size_t index = size_t(x) * srcChannels + c;
+				if(depth == 16){
+					values[c] = (unsigned(row[index * 2]) << 8) | row[index * 2 + 1];
+				} else if(depth == 8){
+					values[c] = row[index];
+				} else {
+					const size_t bit = index * depth;
+					values[c] = (row[bit / 8] >> (8 - depth - (bit % 8))) & maxValue;
+				}
+			}
+			uint8_t* pixel = &_pixels[(size_t(y) * _width + x) * _channels];
+			if(isPalette){
+				if(size_t(values[0]) * 3 + 2 >= palette.size()){
+					return false;
+				}
+				std::memcpy(pixel, &palette[values[0] * 3], 3);
+				if(_channels == 4){
+					pixel[3] = values[0] < paletteAlpha.size() ? paletteAlpha[values[0]] : 255;
+				}
+				continue;
+			}
+			bool transparent = hasKey;
+			for(unsigned int c = 0; c < srcChannels; ++c){
+				pixel[c] = uint8_t(depth == 16 ? values[c] >> 8 : values[c] * 255 / maxValue);
+				transparent = transparent && values[c] == transparentColor[c];
+			}
+			if(hasKey){
+				pixel[srcChannels] = transparent ? 0 : 255;
+			}
+		}
+	}
+	return true;
+}
+
+bool Image::encodePng(std::string & data) const {
+	static const uint8_t colorTypes[5] = { 0, 0, 4, 2, 6 };
+	if(_channels == 0 || _channels > 4){
+		return false;
+	}
+	const size_t rowSize = size_t(_width) * _channels;
+	std::vector<uint8_t> raw;
+	filterRows(_pixels.data(), rowSize, _height, _channels, true, raw);
+	std::string compressed;
+	if(!deflateData(raw, Z_DEFAULT_STRATEGY, compressed)){
+		return false;
+	}
+
+	data.assign("\x89PNG\r\n\x1a\n", 8);
+	uint8_t header[13] = { 0 };
+	for(int i = 0; i < 4; ++i){
+		header[i] = uint8_t(_width >> (24 - 8 * i));
+		header[4 + i] = uint8_t(_height >> (24 - 8 * i));
+	}
+	header[8] = 8;
+	header[9] = colorTypes[_channels];
+	writeChunk(data, "IHDR", header, sizeof(header));
+	writeChunk(data, "IDAT", reinterpret_cast<const uint8_t*>(compressed.data()), compressed.size());
+	writeChunk(data, "IEND", nullptr, 0);
+	return true;
+}
+
+bool Image::optimizePng(const std::string & src, std::string & dst){
+	// Chunks that affect how the image is displayed.
+	static const std::vector<std::string> keptChunks = { "IHDR", "PLTE", "tRNS", "gAMA", "cHRM", "sRGB", "iCCP", "sBIT", "bKGD" };
+	const uint8_t* bytes = reinterpret_cast<const uint8_t*>(src.data());
+	std::string header;
+	std::string compressed;
+	uint32_t width = 0, height = 0;
+	uint8_t depth = 0, colorType = 0, interlace = 0;
+	size_t pos = 8;
+	bool ended = false;
+	while(pos + 12 <= src.size()){
+		const uint32_t length = readUint32(bytes + pos);
+		if(length > src.size() - pos - 12){
+			return false;
+		}
+		const std::string type = src.substr(pos + 4, 4);
+		const uint8_t* chunk = bytes + pos + 8;
+		if(type == "IHDR" && length >= 13){
+			width = readUint32(chunk);
+			height = readUint32(chunk + 4);
+			depth = chunk[8];
+			colorType = chunk[9];
+			interlace = chunk[12];
+		}
+		if(type == "IDAT"){
+			compressed.append(src, pos + 8, length);
+		} else if(type == "IEND"){
+			ended = true;
+			break;
+		} else if(type == "acTL" || (type[0] & 0x20) == 0){
+			// Animations and unknown critical chunks can't be handled.
+			if(std::find(keptChunks.begin(), keptChunks.end(), type) == keptChunks.end()){
+				return false;
+			}
+		}
+		if(type != "IDAT" && std::find(keptChunks.begin(), keptChunks.end(), type) != keptChunks.end()){
+			header.append(src, pos, length + 12);
+		}
+		pos += 12 + length;
+	}
+	static const unsigned int channelCounts[7] = { 1, 0, 3, 1, 2, 0, 4 };
+	if(!ended || width == 0 || height == 0 || colorType > 6 || channelCounts[colorType] == 0 || depth == 0){
+		return false;
+	}
+
+	std::vector<uint8_t> raw;
+	if(!inflateData(compressed, raw)){
+		return false;
+	}
+	// Interlaced images are only compressed again, other images are also filtered again.
+	if(interlace == 0){
+		const size_t rowSize = (size_t(width) * channelCounts[colorType] * depth + 7) / 8;
+		const size_t bpp = (std::max)(size_t(1), size_t(channelCounts[colorType] * depth / 8));
+		if(raw.size() != (rowSize + 1) * height){
+			return false;
+		}
+		std::vector<uint8_t> rows(rowSize * height);
+		for(uint32_t y = 0; y < height; ++y){
+			const uint8_t* row = &raw[y * (rowSize + 1)];
+			if(row[0] > 4){
+				return false;
+			}
+			filterRow(row[0], row + 1, y > 0 ? &rows[(y - 1) * rowSize] : nullptr, rowSize, bpp, true, &rows[y * rowSize]);
+		}
+		// Adaptive filtering rarely helps palette and low depth images.
+		filterRows(rows.data(), rowSize, height, bpp, colorType != 3 && depth >= 8, raw);
+	}
+
+	std::string best;
+	for(const int strategy : { Z_DEFAULT_STRATEGY, Z_FILTERED }){
+		std::string candidate;
+		if(deflateData(raw, strategy, candidate) && (best.empty() || candidate.size() < best.size())){
+			best.swap(candidate);
+		}
+	}
+	if(best.empty()){
+		return false;
+	}
+	dst.assign("\x89PNG\r\n\x1a\n", 8);
+	dst.append(header);
+	writeChunk(dst, "IDAT", reinterpret_cast<const uint8_t*>(best.data()), best.size());
+	writeChunk(dst, "IEND", nullptr, 0);
+	return true;
+}
+
+#endif
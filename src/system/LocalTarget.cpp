@@ -0,0 +1,159 @@
+#include "system/LocalTarget.hpp"
+#include "system/TextUtilities.hpp"
+
+bool LocalTarget::copyItem(const fs::path & src, const fs::path & dst, bool force){
+	const std::string nameStr = src.filename();
+	if(TextUtilities::hasPrefix(nameStr, ".")){
+		return true;
+	}
+	if(!System::itemExists(src)){
+		return false;
+	}
+
+	if(System::isDirectory(src)){
+		// Directories are kept, their files will be replaced one by one.
+		bool res = createDirectory(dst);
+		const auto files = System::listItems(src, false, true);
+		for(const auto & file : files){
+			const bool res2 = copyItem(file, dst / file.filename(), force);
+			res = res && res2;
+		}
+		return res;
+	}
+	if(!System::isFile(src)){
+		return true;
+	}
+
+	uint64_t dstSize = 0;
+	if(!force && itemExists(dst, dstSize)){
+		std::error_code ec;
+		const uint64_t srcSize = uint64_t(fs::file_size(src, ec));
+		// If same size, probably same file, don't copy.
+		if(srcSize == dstSize){
+			return true;
+		}
+	}
+
+	// Write next to the destination then swap, so that the file is never seen partially written.
+	const fs::path tmpPath = dst.parent_path() / ("." + dst.filename().string() + ".thoth");
+	const int64_t size = measure(WRITE, [&]{ return System::copyFile(src, tmpPath); });
+	std::error_code ec;
+	if(size < 0){
+		fs::remove(tmpPath, ec);
+		return false;
+	}
+	measure(RENAME, [&]{ fs::rename(tmpPath, dst, ec); return 0; });
+	if(ec){
+		fs::remove(tmpPath, ec);
+		return false;
+	}
+	++_stats.uploadedFiles;
+	_stats.bytesSent += uint64_t(size);
+	return true;
+}
+
+bool LocalTarget::createDirectory(const fs::path & path, bool force){
+	if(force && itemExists(path)){
+		removeItem(path);
+	}
+	if(itemExists(path)){
+		return true;
+	}
+	std::error_code ec;
+	const bool res = measure(MKDIR, [&]{ return fs::create_directory(path, ec); });
+	if(res){
+		++_stats.createdDirs;
+	}
+	return res;
+}
+
+bool LocalTarget::removeItem(const fs::path & path){
+	std::error_code ec;
+	const auto count = measure(UNLINK, [&]{ return fs::remove_all(path, ec); });
+	return !ec && count != 0;
+}
+
+bool LocalTarget::removeItems(const std::vector<Item> & items){
+	// Remove all files first, then directories from the deepest to the shallowest, as they have to be empty.
+	std::vector<const Item*> directories;
+	bool res = true;
+	std::error_code ec;
+	for(const Item & item : items){
+		if(item.directory){
+			directories.push_back(&item);
+			continue;
+		}
+		if(measure(UNLINK, [&]{ return fs::remove(item.path, ec); })){
+			++_stats.removedItems;
+		} else {
+			res = false;
+		}
+	}
+	std::sort(directories.begin(), directories.end(), [](const Item* a, const Item* b){
+		return a->path.generic_string().size() > b->path.generic_string().size();
+	});
+	for(const Item* item : directories){
+		if(measure(RMDIR, [&]{ return fs::remove(item->path, ec); })){
+			++_stats.removedItems;
+		} else {
+			res = false;
+		}
+	}
+	return res;
+}
+
+bool LocalTarget::renameItem(const fs::path & src, const fs::path & dst){
+	std::error_code ec;
+	measure(RENAME, [&]{ fs::rename(src, dst, ec); return 0; });
+	return !ec;
+}
+
+bool LocalTarget::listItems(const fs::path & path, bool recursive, std::vector<Item> & items){
+	std::error_code ec;
+	fs::directory_iterator dir = measure(READDIR, [&]{ return fs::directory_iterator(path, ec); });
+	if(ec){
+		return false;
+	}
+	bool res = true;
+	std::vector<fs::path> subdirs;
+	for(const fs::directory_entry & entry : dir){
+		const std::string name = entry.path().filename().string();
+		// Skip hidden items, they are never uploaded and could be user data.
+		if(TextUtilities::hasPrefix(name, ".")){
+			continue;
+		}
+		const fs::file_status status = entry.symlink_status(ec);
+		items.emplace_back();
+		items.back().path = path / name;
+		items.back().directory = fs::is_directory(status);
+		items.back().link = fs::is_symlink(status);
+		if(fs::is_regular_file(status)){
+			items.back().size = uint64_t(entry.file_size(ec));
+		}
+		if(items.back().directory){
+			subdirs.push_back(items.back().path);
+		}
+	}
+	if(recursive){
+		for(const fs::path & subdir : subdirs){
+			res = listItems(subdir, true, items) && res;
+		}
+	}
+	return res;
+}
+
+bool LocalTarget::itemExists(const fs::path & path, uint64_t& size){
+	std::error_code ec;
+	const fs::file_status status = measure(STAT, [&]{ return fs::status(path, ec); });
+	if(!fs::exists(status)){
+		return false;
+	}
+	size = fs::is_regular_file(status) ? uint64_t(fs::file_size(path, ec)) : 0;
+	return true;
+}
+
+bool LocalTarget::readLink(const fs::path & path, fs::path & target){
+	std::error_code ec;
+	target = measure(READLINK, [&]{ return fs::read_symlink(path, ec); });
+	return !ec;
+}
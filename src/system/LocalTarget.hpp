@@ -0,0 +1,34 @@
+#pragma once
+
+#include "Common.hpp"
+#include "system/DeployTarget.hpp"
+
+/**
+ \brief Upload target in a local directory, such as a web server root or a mounted volume. Files are replaced atomically.
+ \ingroup System
+ */
+class LocalTarget : public DeployTarget {
+
+public:
+
+	bool copyItem(const fs::path & src, const fs::path & dst, bool force) override;
+
+	/// Copy to a temporary file, then rename over the destination.
+	uint64_t copyOperations(uint64_t, bool) const override { return 2; }
+
+	bool createDirectory(const fs::path & path, bool force = false) override;
+
+	bool removeItem(const fs::path & path) override;
+
+	bool removeItems(const std::vector<Item> & items) override;
+
+	bool renameItem(const fs::path & src, const fs::path & dst) override;
+
+	bool listItems(const fs::path & path, bool recursive, std::vector<Item> & items) override;
+
+	using DeployTarget::itemExists;
+
+	bool itemExists(const fs::path & path, uint64_t& size) override;
+
+	bool readLink(const fs::path & path, fs::path & target) override;
+};
@@ -17,10 +17,18 @@
 #	undef ERROR
 #endif
 
-// We statically initialize the default logger.
-// We don't really care about its exact construction/destruction moments,
-// but we want it to always be created.
-Log * Log::_defaultLogger = new Log();
+// We lazily create a default logger for each thread, released when the thread exits.
+thread_local std::unique_ptr<Log> Log::_defaultLogger;
+std::string Log::_defaultFilePath = "";
+bool Log::_defaultVerbose = false;
+
+Log & Log::defaultLogger() {
+	if(!_defaultLogger) {
+		_defaultLogger.reset(_defaultFilePath.empty() ? new Log() : new Log(_defaultFilePath, true, _defaultVerbose));
+		_defaultLogger->setVerbose(_defaultVerbose);
+	}
+	return *_defaultLogger;
+}
 
 void Log::set(Level l) {
 	_level		  = l;
@@ -85,31 +93,37 @@ void Log::setVerbose(bool verbose) {
 }
 
 void Log::setDefaultFile(const std::string & filePath) {
-	_defaultLogger->setFile(filePath);
+	_defaultFilePath = filePath;
+	defaultLogger().setFile(filePath);
 }
 
 void Log::setDefaultVerbose(bool verbose) {
-	_defaultLogger->setVerbose(verbose);
+	_defaultVerbose = verbose;
+	defaultLogger().setVerbose(verbose);
 }
 
 Log & Log::Info() {
-	_defaultLogger->set(Level::INFO);
-	return *_defaultLogger;
+	Log & logger = defaultLogger();
+	logger.set(Level::INFO);
+	return logger;
 }
 
 Log & Log::Warning() {
-	_defaultLogger->set(Level::WARNING);
-	return *_defaultLogger;
+	Log & logger = defaultLogger();
+	logger.set(Level::WARNING);
+	return logger;
 }
 
 Log & Log::Error() {
-	_defaultLogger->set(Level::ERROR);
-	return *_defaultLogger;
+	Log & logger = defaultLogger();
+	logger.set(Level::ERROR);
+	return logger;
 }
 
 Log & Log::Verbose() {
-	_defaultLogger->set(Level::VERBOSE);
-	return *_defaultLogger;
+	Log & logger = defaultLogger();
+	logger.set(Level::VERBOSE);
+	return logger;
 }
 
 void Log::flush() {
@@ -4,6 +4,7 @@
 #include <fstream>
 #include <sstream>
 #include <vector>
+#include <memory>
 
 // Fix for Windows headers.
 #ifdef ERROR
@@ -154,5 +155,12 @@ private:
 	bool _appendPrefix	 = false;  ///< Should a domain or level prefix be appended to the current line.
 	bool _useColors		   = false;  ///< Should color formatting be used.
 
-	static Log * _defaultLogger; ///< Default static logger.
+	/** Retrieve the default logger of the calling thread, creating it if needed.
+	 \return the logger
+	 */
+	static Log & defaultLogger();
+
+	static thread_local std::unique_ptr<Log> _defaultLogger; ///< Default logger, one per thread so that lines are never mixed.
+	static std::string _defaultFilePath; ///< Log file shared by all default loggers.
+	static bool _defaultVerbose; ///< Verbosity shared by all default loggers.
 };
@@ -0,0 +1,66 @@
+#include "system/Manifest.hpp"
+
+#include <sstream>
+
+Manifest::Manifest(const fs::path & path) : _path(path) {
+	if(!System::itemExists(path)){
+		return;
+	}
+	std::ifstream file(System::widen(path.string()));
+	std::string line;
+	// Each line contains the hash, size, source and file times, followed by the path that can contain spaces.
+	while(std::getline(file, line)){
+		std::stringstream lineStream(line);
+		Entry entry;
+		lineStream >> std::hex >> entry.hash >> std::dec >> entry.size >> entry.srcTime >> entry.dstTime;
+		if(!lineStream){
+			continue;
+		}
+		std::string key;
+		std::getline(lineStream >> std::ws, key);
+		if(!key.empty()){
+			_entries[key] = entry;
+		}
+	}
+}
+
+bool Manifest::get(const std::string & key, Entry & entry) const {
+	std::lock_guard<std::mutex> lock(_mutex);
+	const auto existing = _entries.find(key);
+	if(existing == _entries.end()){
+		return false;
+	}
+	entry = existing->second;
+	return true;
+}
+
+void Manifest::set(const std::string & key, const Entry & entry){
+	std::lock_guard<std::mutex> lock(_mutex);
+	_entries[key] = entry;
+	_modified = true;
+}
+
+void Manifest::remove(const std::string & key){
+	std::lock_guard<std::mutex> lock(_mutex);
+	_modified = _entries.erase(key) != 0 || _modified;
+}
+
+bool Manifest::save(){
+	std::lock_guard<std::mutex> lock(_mutex);
+	if(!_modified){
+		return true;
+	}
+	std::stringstream str;
+	for(const auto & entry : _entries){
+		str << std::hex << entry.second.hash << std::dec << " " << entry.second.size << " ";
+		str << entry.second.srcTime << " " << entry.second.dstTime << " " << entry.first << "\n";
+	}
+	_modified = !System::writeStringToFile(str.str(), _path);
+	return !_modified;
+}
+
+int64_t Manifest::modificationTime(const fs::path & path){
+	std::error_code ec;
+	const auto time = fs::last_write_time(path, ec);
+	return ec ? 0 : int64_t(time.time_since_epoch().count());
+}
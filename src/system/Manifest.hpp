@@ -0,0 +1,53 @@
+#pragma once
+
+#include "Common.hpp"
+#include "system/System.hpp"
+#include <unordered_map>
+#include <mutex>
+
+/**
+ \brief Record of the files written in a directory, with their size, modification times and content hash, persisted on disk between runs. Can be shared between threads.
+ \ingroup System
+ */
+class Manifest {
+public:
+
+	struct Entry {
+		uint64_t size = 0; ///< Size of the file.
+		int64_t srcTime = 0; ///< Modification time of the source when written.
+		int64_t dstTime = 0; ///< Modification time of the file after writing.
+		uint64_t hash = 0; ///< Content hash, 0 if not computed yet.
+	};
+
+	/** Constructor, loading the existing manifest if any.
+	 \param path the manifest file
+	 */
+	explicit Manifest(const fs::path & path);
+
+	/** Retrieve the entry for a file.
+	 \param key the path of the file relative to the manifest directory
+	 \param entry will contain the entry
+	 \return true if the file is recorded
+	 */
+	bool get(const std::string & key, Entry & entry) const;
+
+	void set(const std::string & key, const Entry & entry);
+
+	void remove(const std::string & key);
+
+	/** Write the manifest to disk if it was modified. */
+	bool save();
+
+	/** Modification time of a file, as stored in entries.
+	 \param path the file path
+	 \return the time, or 0 if unavailable
+	 */
+	static int64_t modificationTime(const fs::path & path);
+
+private:
+
+	fs::path _path; ///< Manifest file.
+	std::unordered_map<std::string, Entry> _entries; ///< Entries indexed by relative path.
+	mutable std::mutex _mutex; ///< Protects entries.
+	bool _modified = false; ///< Was any entry modified since loading.
+};
@@ -0,0 +1,144 @@
+#include "system/MinHash.hpp"
+#include "system/System.hpp"
+#include "system/TextUtilities.hpp"
+
+#include <unordered_map>
+#include <unordered_set>
+
+/// Shortest word taken into account, in bytes.
+static const size_t minWordSize = 4;
+/// Number of words each tag counts as.
+static const size_t tagWeight = 16;
+/// Number of values in each band, two texts are compared if all values of one of their bands are equal.
+/// With 21 bands of 3 values, texts with a similarity of 0.5 are compared with a probability of 94%, 0.35 of 60%, 0.15 of 7% and 0.05 of 0.3%.
+static const size_t bandRows = 3;
+
+/// Common English words, that appear in most texts whatever their subject.
+static const std::unordered_set<std::string> & stopWords(){
+	static const std::unordered_set<std::string> words = {
+		"about", "above", "after", "again", "against", "also", "always", "among", "another", "anything", "around", "because", "been", "before", "being", "below", "between", "both", "cannot", "could", "didn", "does", "doesn", "doing", "done", "down", "during", "each", "either", "else", "enough", "even", "ever", "every", "everything", "example", "first", "from", "further", "gets", "getting", "give", "given", "goes", "going", "good", "great", "have", "having", "here", "however", "instead", "into", "itself", "just", "know", "last", "later", "least", "less", "like", "little", "long", "look", "made", "make", "makes", "making", "many", "might", "more", "most", "much", "must", "need", "needs", "never", "next", "nothing", "often", "once", "only", "other", "others", "ours", "over", "part", "quite", "rather", "really", "right", "same", "second", "seems", "several", "should", "show", "simply", "since", "some", "something", "still", "such", "take", "than", "that", "their", "them", "themselves", "then", "there", "these", "they", "thing", "things", "think", "this", "those", "though", "three", "through", "thus", "time", "together", "under", "until", "upon", "used", "uses", "using", "very", "want", "well", "were", "what", "when", "where", "whether", "which", "while", "will", "with", "within", "without", "work", "would", "year", "years", "your", "yours", "yourself"
+	};
+	return words;
+}
+
+static bool isWordChar(unsigned char c){
+	return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c >= 0x80;
+}
+
+static uint32_t mix(uint32_t h){
+	h ^= h >> 16;
+	h *= 0x85ebca6bu;
+	h ^= h >> 13;
+	h *= 0xc2b2ae35u;
+	h ^= h >> 16;
+	return h;
+}
+
+void MinHash::insert(uint64_t hash, Signature & signature){
+	// Derive all hash functions from two halves of the feature hash.
+	const uint32_t h1 = uint32_t(hash);
+	const uint32_t h2 = uint32_t(hash >> 32) | 1u;
+	for(size_t i = 0; i < size; ++i){
+		const uint32_t value = mix(h1 + uint32_t(i) * h2);
+		if(value < signature[i]){
+			signature[i] = value;
+		}
+	}
+}
+
+MinHash::Signature MinHash::signature(const std::string & text, const std::vector<std::string> & tags){
+	Signature signature;
+	signature.fill(UINT32_MAX);
+
+	// Only distinct words matter.
+	std::unordered_set<uint64_t> words;
+	std::string word;
+	for(size_t i = 0; i <= text.size(); ++i){
+		const unsigned char c = i < text.size() ? static_cast<unsigned char>(text[i]) : ' ';
+		if(isWordChar(c)){
+			word.push_back(char((c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c));
+			continue;
+		}
+		if(word.size() >= minWordSize && stopWords().count(word) == 0){
+			words.insert(TextUtilities::hash(word));
+		}
+		word.clear();
+	}
+	for(const std::string & tag : tags){
+		for(size_t i = 0; i < tagWeight; ++i){
+			words.insert(TextUtilities::hash("#" + tag + "#" + std::to_string(i)));
+		}
+	}
+	for(const uint64_t hash : words){
+		insert(hash, signature);
+	}
+	return signature;
+}
+
+float MinHash::similarity(const Signature & a, const Signature & b){
+	size_t equal = 0;
+	for(size_t i = 0; i < size; ++i){
+		equal += size_t(a[i] == b[i]);
+	}
+	return float(equal) / float(size);
+}
+
+std::vector<std::vector<size_t>> MinHash::nearest(const std::vector<Signature> & signatures, const std::vector<bool> & candidates, size_t count){
+	const size_t bandCount = size / bandRows;
+	const auto bandKey = [](const Signature & signature, size_t band){
+		uint64_t key = 0;
+		for(size_t r = 0; r < bandRows; ++r){
+			key = key * 0x9e3779b97f4a7c15ull + signature[band * bandRows + r];
+		}
+		return key;
+	};
+	// Signatures of texts without any word would all be equal.
+	const auto empty = [](const Signature & signature){
+		return signature[0] == UINT32_MAX;
+	};
+
+	// Group candidates by the values of each band.
+	std::vector<std::unordered_map<uint64_t, std::vector<size_t>>> buckets(bandCount);
+	for(size_t sid = 0; sid < signatures.size(); ++sid){
+		if(!candidates[sid] || empty(signatures[sid])){
+			continue;
+		}
+		for(size_t band = 0; band < bandCount; ++band){
+			buckets[band][bandKey(signatures[sid], band)].push_back(sid);
+		}
+	}
+
+	std::vector<std::vector<size_t>> results(signatures.size());
+	System::forEachParallel(signatures.size(), [&](size_t sid){
+		const Signature & signature = signatures[sid];
+		if(count == 0 || empty(signature)){
+			return;
+		}
+		std::vector<size_t> others;
+		for(size_t band = 0; band < bandCount; ++band){
+			const auto bucket = buckets[band].find(bandKey(signature, band));
+			if(bucket != buckets[band].end()){
+				others.insert(others.end(), bucket->second.begin(), bucket->second.end());
+			}
+		}
+		std::sort(others.begin(), others.end());
+		others.erase(std::unique(others.begin(), others.end()), others.end());
+
+		std::vector<std::pair<float, size_t>> scores;
+		scores.reserve(others.size());
+		for(const size_t other : others){
+			if(other != sid){
+				scores.emplace_back(similarity(signature, signatures[other]), other);
+			}
+		}
+		// Most similar first, earlier signatures first in case of equality.
+		const size_t kept = (std::min)(count, scores.size());
+		std::partial_sort(scores.begin(), scores.begin() + kept, scores.end(), [](const std::pair<float, size_t> & a, const std::pair<float, size_t> & b){
+			return a.first != b.first ? a.first > b.first : a.second < b.second;
+		});
+		for(size_t i = 0; i < kept; ++i){
+			results[sid].push_back(scores[i].second);
+		}
+	});
+	return results;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "Common.hpp"
+
+#include <array>
+
+/**
+ \brief Estimate the similarity of texts from small signatures, and find the most similar ones without comparing all pairs. Each signature stores the minimum of several hash functions over the words of a text, the fraction of equal values estimating the Jaccard similarity of the word sets. Signatures are split in bands, and only texts sharing at least one band are compared: the threshold is a similarity of about 0.35, unrelated texts are rarely compared.
+ \ingroup System
+ */
+class MinHash {
+public:
+
+	/// Number of hash functions.
+	static const size_t size = 64;
+
+	/// Changes when signatures are computed differently, invalidating stored ones.
+	static const uint32_t version = 2;
+
+	using Signature = std::array<uint32_t, size>;
+
+	/** Compute the signature of a text. Words shorter than four characters and common English words are ignored, and each tag counts as several words.
+	 \param text the text to process
+	 \param tags additional features, such as keywords
+	 \return the signature
+	 */
+	static Signature signature(const std::string & text, const std::vector<std::string> & tags);
+
+	/** Estimate the similarity of two texts.
+	 \param a the signature of the first text
+	 \param b the signature of the second text
+	 \return the estimated Jaccard similarity, between 0 and 1
+	 */
+	static float similarity(const Signature & a, const Signature & b);
+
+	/** Find the most similar candidates of each signature, processed in parallel.
+	 \param signatures the signatures to compare
+	 \param candidates flag for each signature that can be returned
+	 \param count the maximum number of results for each signature
+	 \return the indices of the most similar candidates for each signature, most similar first, excluding itself
+	 */
+	static std::vector<std::vector<size_t>> nearest(const std::vector<Signature> & signatures, const std::vector<bool> & candidates, size_t count);
+
+private:
+
+	static void insert(uint64_t hash, Signature & signature);
+};
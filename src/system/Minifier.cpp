@@ -0,0 +1,306 @@
+#include "system/Minifier.hpp"
+
+#include <cctype>
+
+static bool isSpace(char c){
+	return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f';
+}
+
+/// Characters allowed in an attribute value without quotes.
+static bool isUnquotedSafe(char c){
+	return std::isalnum(static_cast<unsigned char>(c)) || c == '-' || c == '_' || c == '.' || c == ':' || c == '#' || c == '%' || c == ',' || c == ';' || c == '+';
+}
+
+/// Find the position of the closing tag of an element, ignoring case.
+static size_t findClosingTag(const std::string & src, size_t start, const std::string & name){
+	size_t pos = src.find("</", start);
+	while(pos != std::string::npos){
+		size_t i = 0;
+		while(i < name.size() && pos + 2 + i < src.size() && std::tolower(static_cast<unsigned char>(src[pos + 2 + i])) == name[i]){
+			++i;
+		}
+		if(i == name.size()){
+			return pos;
+		}
+		pos = src.find("</", pos + 2);
+	}
+	return src.size();
+}
+
+std::string Minifier::html(const std::string & src){
+	return markup(src, false);
+}
+
+std::string Minifier::xml(const std::string & src){
+	return markup(src, true);
+}
+
+std::string Minifier::markup(const std::string & src, bool isXml){
+	std::string dst;
+	dst.reserve(src.size());
+	const size_t size = src.size();
+
+	// Whitespace is collapsed to a single character, a line break if the original contained one.
+	bool pendingSpace = false;
+	bool pendingNewline = false;
+	const auto flushSpace = [&dst, &pendingSpace, &pendingNewline](){
+		if(pendingSpace && !dst.empty()){
+			dst.push_back(pendingNewline ? '\n' : ' ');
+		}
+		pendingSpace = false;
+		pendingNewline = false;
+	};
+
+	size_t i = 0;
+	while(i < size){
+		const char c = src[i];
+		if(c != '<'){
+			if(isSpace(c)){
+				pendingSpace = true;
+				pendingNewline = pendingNewline || c == '\n';
+			} else {
+				flushSpace();
+				dst.push_back(c);
+			}
+			++i;
+			continue;
+		}
+
+		// Comments are removed, except conditional ones.
+		if(src.compare(i, 4, "<!--") == 0){
+			const size_t end = src.find("-->", i + 4);
+			const size_t stop = end == std::string::npos ? size : end + 3;
+			if(src.compare(i, 5, "<!--[") == 0){
+				flushSpace();
+				dst.append(src, i, stop - i);
+			}
+			i = stop;
+			continue;
+		}
+		// Embedded HTML content, for instance in the feed.
+		if(src.compare(i, 9, "<![CDATA[") == 0){
+			const size_t end = src.find("]]>", i + 9);
+			const size_t stop = end == std::string::npos ? size : end;
+			flushSpace();
+			dst.append("<![CDATA[");
+			dst.append(markup(src.substr(i + 9, stop - i - 9), false));
+			dst.append("]]>");
+			i = (std::min)(stop + 3, size);
+			continue;
+		}
+		// Doctype and processing instructions are kept as-is.
+		if(src.compare(i, 2, "<!") == 0 || src.compare(i, 2, "<?") == 0){
+			const size_t end = src.find('>', i);
+			const size_t stop = end == std::string::npos ? size : end + 1;
+			flushSpace();
+			dst.append(src, i, stop - i);
+			i = stop;
+			continue;
+		}
+
+		// Tag name.
+		size_t k = i + 1;
+		const bool closing = k < size && src[k] == '/';
+		if(closing){
+			++k;
+		}
+		std::string name;
+		while(k < size && (std::isalnum(static_cast<unsigned char>(src[k])) || src[k] == '-' || src[k] == ':')){
+			name.push_back(char(std::tolower(static_cast<unsigned char>(src[k]))));
+			++k;
+		}
+		// Not a tag, just a character of the text.
+		if(name.empty()){
+			flushSpace();
+			dst.push_back(c);
+			++i;
+			continue;
+		}
+		flushSpace();
+		dst.append(src, i, k - i);
+
+		// Attributes.
+		while(k < size && src[k] != '>'){
+			const char ac = src[k];
+			if(isSpace(ac)){
+				while(k < size && isSpace(src[k])){
+					++k;
+				}
+				// No space is needed at the end of the tag and around equal signs.
+				const bool atEnd = k >= size || src[k] == '>' || (src[k] == '/' && k + 1 < size && src[k + 1] == '>');
+				if(!atEnd && src[k] != '=' && dst.back() != '='){
+					dst.push_back(' ');
+				}
+				continue;
+			}
+			if(ac == '"' || ac == '\''){
+				const size_t end = src.find(ac, k + 1);
+				if(end == std::string::npos){
+					dst.append(src, k, size - k);
+					k = size;
+					break;
+				}
+				// Quotes are not needed for simple values, except before a slash that would be read as part of the value.
+				size_t next = end + 1;
+				while(next < size && isSpace(src[next])){
+					++next;
+				}
+				bool unquote = !isXml && end > k + 1 && dst.back() == '=' && (next >= size || src[next] != '/');
+				for(size_t vid = k + 1; unquote && vid < end; ++vid){
+					unquote = isUnquotedSafe(src[vid]);
+				}
+				if(unquote){
+					dst.append(src, k + 1, end - k - 1);
+				} else {
+					dst.append(src, k, end - k + 1);
+				}
+				k = end + 1;
+				continue;
+			}
+			dst.push_back(ac);
+			++k;
+		}
+		if(k < size){
+			dst.push_back('>');
+			++k;
+		}
+		i = k;
+
+		// Keep the content of elements where whitespace matters or that are not HTML.
+		if(!closing && !isXml && (name == "pre" || name == "code" || name == "textarea" || name == "script" || name == "style")){
+			const size_t end = findClosingTag(src, i, name);
+			dst.append(src, i, end - i);
+			i = end;
+		}
+	}
+	return dst;
+}
+
+std::string Minifier::css(const std::string & src){
+	std::string dst;
+	dst.reserve(src.size());
+	const size_t size = src.size();
+	// Whitespace can be removed around these characters. Colons are excluded as they can start pseudo-classes in selectors.
+	const auto isSeparator = [](char c){
+		return c == '{' || c == '}' || c == ';' || c == ',' || c == '>';
+	};
+	bool pendingSpace = false;
+	size_t i = 0;
+	while(i < size){
+		const char c = src[i];
+		if(c == '/' && i + 1 < size && src[i + 1] == '*'){
+			const size_t end = src.find("*/", i + 2);
+			i = end == std::string::npos ? size : end + 2;
+			continue;
+		}
+		if(isSpace(c)){
+			pendingSpace = true;
+			++i;
+			continue;
+		}
+		if(pendingSpace && !dst.empty() && !isSeparator(dst.back()) && dst.back() != ':' && !isSeparator(c)){
+			dst.push_back(' ');
+		}
+		pendingSpace = false;
+		if(c == '"' || c == '\''){
+			// Strings are kept as-is.
+			size_t end = i + 1;
+			while(end < size && src[end] != c){
+				end += (src[end] == '\\') ? 2 : 1;
+			}
+			end = (std::min)(end + 1, size);
+			dst.append(src, i, end - i);
+			i = end;
+			continue;
+		}
+		// The last declaration of a block doesn't need a semicolon.
+		if(c == '}' && !dst.empty() && dst.back() == ';'){
+			dst.back() = '}';
+			++i;
+			continue;
+		}
+		dst.push_back(c);
+		++i;
+	}
+	return dst;
+}
+
+std::string Minifier::js(const std::string & src){
+	std::string dst;
+	dst.reserve(src.size());
+	const size_t size = src.size();
+	// A slash starts a regular expression if it can't be a division.
+	const auto canStartRegex = [&dst](){
+		size_t pos = dst.size();
+		while(pos > 0 && isSpace(dst[pos - 1])){
+			--pos;
+		}
+		if(pos == 0){
+			return true;
+		}
+		const char prev = dst[pos - 1];
+		if(std::string("(,=:[!&|?{};+-*%<>~^").find(prev) != std::string::npos){
+			return true;
+		}
+		for(const std::string keyword : { "return", "typeof", "case", "in", "of", "void", "delete", "throw" }){
+			if(pos >= keyword.size() && dst.compare(pos - keyword.size(), keyword.size(), keyword) == 0){
+				return pos == keyword.size() || !(std::isalnum(static_cast<unsigned char>(dst[pos - keyword.size() - 1])) || dst[pos - keyword.size() - 1] == '_' || dst[pos - keyword.size() - 1] == '$');
+			}
+		}
+		return false;
+	};
+	bool pendingSpace = false;
+	bool pendingNewline = false;
+	size_t i = 0;
+	while(i < size){
+		const char c = src[i];
+		if(c == '/' && i + 1 < size && src[i + 1] == '/'){
+			const size_t end = src.find('\n', i);
+			i = end == std::string::npos ? size : end;
+			continue;
+		}
+		if(c == '/' && i + 1 < size && src[i + 1] == '*'){
+			const size_t end = src.find("*/", i + 2);
+			i = end == std::string::npos ? size : end + 2;
+			pendingSpace = true;
+			continue;
+		}
+		if(isSpace(c)){
+			pendingSpace = true;
+			pendingNewline = pendingNewline || c == '\n';
+			++i;
+			continue;
+		}
+		if(pendingSpace && !dst.empty()){
+			dst.push_back(pendingNewline ? '\n' : ' ');
+		}
+		pendingSpace = false;
+		pendingNewline = false;
+		const bool isRegex = c == '/' && canStartRegex();
+		if(c == '"' || c == '\'' || c == '`' || isRegex){
+			// Literals are kept as-is.
+			size_t end = i + 1;
+			bool inClass = false;
+			while(end < size && (src[end] != c || inClass)){
+				if(src[end] == '\\'){
+					end += 2;
+					continue;
+				}
+				if(isRegex && (src[end] == '[' || src[end] == ']')){
+					inClass = src[end] == '[';
+				}
+				if(isRegex && src[end] == '\n'){
+					break;
+				}
+				++end;
+			}
+			end = (std::min)(end + 1, size);
+			dst.append(src, i, end - i);
+			i = end;
+			continue;
+		}
+		dst.push_back(c);
+		++i;
+	}
+	return dst;
+}
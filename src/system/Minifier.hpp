@@ -0,0 +1,39 @@
+#pragma once
+
+#include "Common.hpp"
+
+/**
+ \brief Reduce the size of generated files without changing how they are rendered.
+ \ingroup System
+ */
+class Minifier {
+public:
+
+	/** Minify HTML, collapsing whitespace and removing comments and unneeded attribute quotes. The content of pre, code, textarea, script and style elements is kept as-is. Runs in linear time.
+	 \param src the HTML content
+	 \return the minified content
+	 */
+	static std::string html(const std::string & src);
+
+	/** Minify XML, collapsing whitespace and removing comments. CDATA sections are minified as HTML.
+	 \param src the XML content
+	 \return the minified content
+	 */
+	static std::string xml(const std::string & src);
+
+	/** Minify CSS, removing comments and whitespace that does not separate tokens.
+	 \param src the stylesheet content
+	 \return the minified content
+	 */
+	static std::string css(const std::string & src);
+
+	/** Minify JavaScript, removing comments and indentation. Line breaks are kept so that automatic semicolon insertion is not affected.
+	 \param src the script content
+	 \return the minified content
+	 */
+	static std::string js(const std::string & src);
+
+private:
+
+	static std::string markup(const std::string & src, bool isXml);
+};
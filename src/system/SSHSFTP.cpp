@@ -4,6 +4,8 @@
 #include <sys/stat.h>
 #include "system/SSHSFTP.hpp"
 #include "system/TextUtilities.hpp"
+#include <sstream>
+#include <iomanip>
 
 #ifdef _WIN32
 #include <fcntl.h>
@@ -26,7 +28,7 @@
 
 #define CREATE_AUTH
 
-Server::Server(const std::string & domain, const std::string & user, const int port){
+Server::Server(const std::string & domain, const std::string & user, const int port, const fs::path & knownHosts){
 
 	ssh_init();
 	_ssh = ssh_new();
@@ -38,6 +40,10 @@ Server::Server(const std::string & domain, const std::string & user, const int p
 	ssh_options_set(_ssh, SSH_OPTIONS_HOST, domain.c_str());
 	ssh_options_set(_ssh, SSH_OPTIONS_PORT, &port);
 	ssh_options_set(_ssh, SSH_OPTIONS_LOG_VERBOSITY, &_verbosity);
+	if(!knownHosts.empty()){
+		ssh_options_set(_ssh, SSH_OPTIONS_KNOWNHOSTS, knownHosts.string().c_str());
+		ssh_options_set(_ssh, SSH_OPTIONS_GLOBAL_KNOWNHOSTS, knownHosts.string().c_str());
+	}
 	if(ssh_connect(_ssh)){
 		Log::Error() << Log::Server << "Unable to connect via SSH: " << ssh_get_error(_ssh) << std::endl;
 		disconnect();
@@ -99,6 +105,17 @@ void Server::disconnect(){
 	_connected = false;
 }
 
+bool Server::keepAlive(){
+	if(!_connected){
+		return false;
+	}
+	if(ssh_send_ignore(_ssh, "keepalive") != SSH_OK || !ssh_is_connected(_ssh)){
+		disconnect();
+		return false;
+	}
+	return true;
+}
+
 bool Server::copyItem(const fs::path & src, const fs::path & dst, bool force){
 	if(!_connected){
 		Log::Error() << Log::Server << "No SFTP session running." << std::endl;
@@ -131,15 +148,19 @@ bool Server::copyItem(const fs::path & src, const fs::path & dst, bool force){
 			res = res && res2;
 		}
 	} else if(System::isFile(src)){
+		// Content hash is only needed to detect duplicated files.
+		const uint64_t srcHash = _linkDuplicates ? System::hashFile(src) : 0;
+
+		// Retrieve size of file on disk.
+		std::error_code ec;
+		const uint64_t srcSize = uint64_t(fs::file_size(src, ec));
 
 		// If the dst file still exist after potential forced deletion,
 		// compare size with source.
 		if(dstExists){
-			// Retrieve size of file on disk.
-			std::error_code ec;
-			const uint64_t srcSize = uint64_t(fs::file_size(src, ec));
 			// If same size, probably same file, don't copy.
 			// TODO: more thorough comparison (time?).
+			// Its content is not checked, so it can't be used as the source of duplicates.
 			if(srcSize == dstSize){
 				return true;
 			}
@@ -148,39 +169,94 @@ bool Server::copyItem(const fs::path & src, const fs::path & dst, bool force){
 			dstExists = false;
 		}
 
+		// If the same content is already on the server, link to its stored copy instead of uploading it again.
+		if(_linkDuplicates){
+			const auto existing = _remoteFiles.find(srcHash);
+			fs::path stored;
+			if(existing != _remoteFiles.end() && storeContent(existing->second, srcHash, srcSize, force, stored)){
+				existing->second = stored;
+				const std::string targetStr = stored.lexically_relative(dst.parent_path()).generic_string();
+				const std::string linkStr = dst.generic_string();
+				if(measure(LINK, [&]{ return sftp_symlink(_sftp, targetStr.c_str(), linkStr.c_str()); }) == 0){
+					++_stats.linkedFiles;
+					return true;
+				}
+				// Else fallback to a regular upload.
+			}
+		}
+
 		const std::string dstStr = dst.generic_string();
 		const mode_t mode = S_IRUSR_TH | S_IWUSR_TH | S_IRGRP_TH | S_IROTH_TH;
 
-		sftp_file dstFile = sftp_open(_sftp, dstStr.c_str(), O_WRONLY | O_CREAT, mode);
+		sftp_file dstFile = measure(OPEN, [&]{ return sftp_open(_sftp, dstStr.c_str(), O_WRONLY | O_CREAT, mode); });
 		if(!dstFile){
 			res = false;
 		} else {
 			std::ifstream srcFile(System::widen(src.string()), std::ios::in | std::ios::binary);
-			std::vector<char> buffer(4096);
+			std::vector<char> buffer(writeChunkSize);
 			while(srcFile.read(buffer.data(), buffer.size())){
 				const ssize_t len = ssize_t(buffer.size());
-				if(sftp_write(dstFile, buffer.data(), len) != len){
+				if(measure(WRITE, [&]{ return sftp_write(dstFile, buffer.data(), len); }) != len){
 					res = false;
 					break;
 				}
+				_stats.bytesSent += uint64_t(len);
 			}
 			if(!srcFile){
 				const ssize_t len = ssize_t(srcFile.gcount());
-				if(sftp_write(dstFile, buffer.data(), len) != len){
+				if(measure(WRITE, [&]{ return sftp_write(dstFile, buffer.data(), len); }) != len){
 					res = false;
 				}
+				_stats.bytesSent += uint64_t(len);
 			}
 			
 			srcFile.close();
-			sftp_close(dstFile);
+			measure(CLOSE, [&]{ return sftp_close(dstFile); });
 			if(res){
 				++_stats.uploadedFiles;
+				// Only files uploaded during this session are known to have this content.
+				if(_linkDuplicates){
+					_remoteFiles.emplace(srcHash, dst);
+				}
 			}
 		}
 	}
 	return res;
 }
 
+bool Server::storeContent(const fs::path & path, uint64_t hash, uint64_t size, bool replace, fs::path & stored){
+	std::stringstream name;
+	name << std::hex << std::setw(16) << std::setfill('0') << hash;
+	stored = _storeDir / name.str();
+	if(path == stored){
+		return true;
+	}
+	if(!createDirectory(_storeDir)){
+		return false;
+	}
+	uint64_t storedSize = 0;
+	if(itemExists(stored, storedSize)){
+		// Keep the uploaded file as is and link to the stored copy, unless it is outdated.
+		if(!replace && storedSize == size){
+			return true;
+		}
+		if(!removeItem(stored)){
+			return false;
+		}
+	}
+	if(!renameItem(path, stored)){
+		return false;
+	}
+	const std::string targetStr = stored.lexically_relative(path.parent_path()).generic_string();
+	const std::string linkStr = path.generic_string();
+	if(measure(LINK, [&]{ return sftp_symlink(_sftp, targetStr.c_str(), linkStr.c_str()); }) != 0){
+		// Put the file back in place.
+		renameItem(stored, path);
+		return false;
+	}
+	return true;
+}
+
 bool Server::createDirectory(const fs::path & path, bool force){
 	if(!_connected){
 		Log::Error() << Log::Server << "No SFTP session running." << std::endl;
@@ -197,7 +273,7 @@ bool Server::createDirectory(const fs::path & path, bool force){
 
 	mode_t mode = S_IRWXU_TH | S_IRGRP_TH | S_IXGRP_TH | S_IROTH_TH | S_IXOTH_TH;
 	const std::string pathStr = path.generic_string();
-	const int res =  sftp_mkdir(_sftp, pathStr.c_str(), mode);
+	const int res = measure(MKDIR, [&]{ return sftp_mkdir(_sftp, pathStr.c_str(), mode); });
 	if(res == 0){
 		++_stats.createdDirs;
 	}
@@ -214,47 +290,123 @@ bool Server::removeItem(const fs::path & path){
 		return true;
 	}
 	const std::string pathStr = path.generic_string();
-	sftp_attributes item = sftp_stat(_sftp, pathStr.c_str());
+	sftp_attributes item = measure(STAT, [&]{ return sftp_stat(_sftp, pathStr.c_str()); });
 	if(!item){
 		return false;
 	}
 	
 	if(item->type == SSH_FILEXFER_TYPE_DIRECTORY){
 		// Iterate over directory elements and recursively remove them.
-		const sftp_dir dir = sftp_opendir(_sftp, pathStr.c_str());
+		const sftp_dir dir = measure(READDIR, [&]{ return sftp_opendir(_sftp, pathStr.c_str()); });
 		if(!dir){
 			sftp_attributes_free(item);
 			return false;
 		}
 		bool res = true;
 		sftp_attributes file;
-		while((file = sftp_readdir(_sftp, dir))){
+		while((file = readDirectory(dir))){
 			const std::string name(file->name);
 			res = res && removeItem(path / name);
 			sftp_attributes_free(file);
 		}
-		if(sftp_dir_eof(dir) == 0 || sftp_closedir(dir) == SSH_ERROR){
+		if(sftp_dir_eof(dir) == 0 || measure(READDIR, [&]{ return sftp_closedir(dir); }) == SSH_ERROR){
 			sftp_attributes_free(item);
 			return false;
 		}
-		const bool resDir = (sftp_rmdir(_sftp, pathStr.c_str()) == 0);
+		const bool resDir = (measure(RMDIR, [&]{ return sftp_rmdir(_sftp, pathStr.c_str()); }) == 0);
 		sftp_attributes_free(item);
 		return res && resDir;
 	} else if(item->type == SSH_FILEXFER_TYPE_REGULAR || item->type == SSH_FILEXFER_TYPE_SYMLINK){
 		sftp_attributes_free(item);
-		return sftp_unlink(_sftp, pathStr.c_str()) == 0;
+		return measure(UNLINK, [&]{ return sftp_unlink(_sftp, pathStr.c_str()); }) == 0;
 	}
 	sftp_attributes_free(item);
 	return false;
 }
 
+bool Server::removeItems(const std::vector<Item> & items){
+	if(!_connected){
+		Log::Error() << Log::Server << "No SFTP session running." << std::endl;
+		return false;
+	}
+	// Types are already known from the listing, so no stat is needed before each deletion.
+	// Remove all files first, then directories from the deepest to the shallowest, as they have to be empty.
+	std::vector<const Item*> directories;
+	bool res = true;
+	for(const Item & item : items){
+		if(item.directory){
+			directories.push_back(&item);
+			continue;
+		}
+		const std::string pathStr = item.path.generic_string();
+		if(measure(UNLINK, [&]{ return sftp_unlink(_sftp, pathStr.c_str()); }) == 0){
+			++_stats.removedItems;
+		} else {
+			res = false;
+		}
+	}
+	std::sort(directories.begin(), directories.end(), [](const Item* a, const Item* b){
+		return a->path.generic_string().size() > b->path.generic_string().size();
+	});
+	for(const Item* item : directories){
+		const std::string pathStr = item->path.generic_string();
+		if(measure(RMDIR, [&]{ return sftp_rmdir(_sftp, pathStr.c_str()); }) == 0){
+			++_stats.removedItems;
+		} else {
+			res = false;
+		}
+	}
+	return res;
+}
+
+bool Server::listItems(const fs::path & path, bool recursive, std::vector<Item> & items){
+	if(!_connected){
+		Log::Error() << Log::Server << "No SFTP session running." << std::endl;
+		return false;
+	}
+	const std::string pathStr = path.generic_string();
+	const sftp_dir dir = measure(READDIR, [&]{ return sftp_opendir(_sftp, pathStr.c_str()); });
+	if(!dir){
+		return false;
+	}
+	bool res = true;
+	std::vector<fs::path> subdirs;
+	sftp_attributes file;
+	while((file = readDirectory(dir))){
+		const std::string name(file->name);
+		// Skip hidden items, they are never uploaded and could be user data.
+		if(!TextUtilities::hasPrefix(name, ".")){
+			items.emplace_back();
+			items.back().path = path / name;
+			items.back().size = file->size;
+			items.back().directory = file->type == SSH_FILEXFER_TYPE_DIRECTORY;
+			items.back().link = file->type == SSH_FILEXFER_TYPE_SYMLINK;
+			if(items.back().directory){
+				subdirs.push_back(items.back().path);
+			}
+		}
+		sftp_attributes_free(file);
+	}
+	if(sftp_dir_eof(dir) == 0){
+		res = false;
+	}
+	measure(READDIR, [&]{ return sftp_closedir(dir); });
+
+	if(recursive){
+		for(const fs::path & subdir : subdirs){
+			res = listItems(subdir, true, items) && res;
+		}
+	}
+	return res;
+}
+
 bool Server::itemExists(const fs::path & path, uint64_t& size){
 	if(!_connected){
 		Log::Error() << Log::Server << "No SFTP session running." << std::endl;
 		return false;
 	}
 	const std::string pathStr = path.generic_string();
-	sftp_attributes item = sftp_stat(_sftp, pathStr.c_str());
+	sftp_attributes item = measure(STAT, [&]{ return sftp_stat(_sftp, pathStr.c_str()); });
 	if(item){
 		size = item->size;
 		sftp_attributes_free(item);
@@ -263,13 +415,40 @@ bool Server::itemExists(const fs::path & path, uint64_t& size){
 	return false;
 }
 
-bool Server::itemExists(const fs::path & path){
-	uint64_t size;
-	return itemExists(path, size);
+bool Server::renameItem(const fs::path & src, const fs::path & dst){
+	if(!_connected){
+		Log::Error() << Log::Server << "No SFTP session running." << std::endl;
+		return false;
+	}
+	const std::string srcStr = src.generic_string();
+	const std::string dstStr = dst.generic_string();
+	return measure(RENAME, [&]{ return sftp_rename(_sftp, srcStr.c_str(), dstStr.c_str()); }) == 0;
+}
+
+bool Server::readLink(const fs::path & path, fs::path & target){
+	if(!_connected){
+		Log::Error() << Log::Server << "No SFTP session running." << std::endl;
+		return false;
+	}
+	const std::string pathStr = path.generic_string();
+	char* targetStr = measure(READLINK, [&]{ return sftp_readlink(_sftp, pathStr.c_str()); });
+	if(!targetStr){
+		return false;
+	}
+	target = fs::path(std::string(targetStr));
+	ssh_string_free_char(targetStr);
+	return true;
 }
 
-void Server::resetStats(){
-	_stats = Stats();
+sftp_attributes Server::readDirectory(sftp_dir dir){
+	// Remaining entries of the last batch are parsed locally. This relies on the layout of
+	// sftp_dir_struct, public from libssh 0.9 (vendored) up to 0.11; Linux builds use the system libssh.
+#if LIBSSH_VERSION_INT >= SSH_VERSION_INT(0, 9, 0) && LIBSSH_VERSION_INT < SSH_VERSION_INT(0, 12, 0)
+	if(dir->buffer != nullptr || dir->eof){
+		return sftp_readdir(_sftp, dir);
+	}
+#endif
+	return measure(READDIR, [&]{ return sftp_readdir(_sftp, dir); });
 }
 
 int Server::verifyHost(){
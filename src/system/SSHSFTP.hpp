@@ -1,52 +1,96 @@
 
 #include "Common.hpp"
 #include "Settings.hpp"
-#include "system/System.hpp"
+#include "system/DeployTarget.hpp"
+#include <unordered_map>
 
 
 struct ssh_session_struct;
 struct sftp_session_struct;
+struct sftp_dir_struct;
+struct sftp_attributes_struct;
 typedef struct ssh_session_struct* ssh_session;
 typedef struct sftp_session_struct* sftp_session;
+typedef struct sftp_dir_struct* sftp_dir;
+typedef struct sftp_attributes_struct* sftp_attributes;
 
-class Server {
+/**
+ \brief Upload target on a SFTP server.
+ \ingroup System
+ */
+class Server : public DeployTarget {
 	
 public:
 
-	struct Stats {
-		unsigned int uploadedFiles = 0;
-		unsigned int createdDirs = 0;
-	};
-	
-	Server(const std::string & domain, const std::string & user, const int port);
+	/// Size of the data sent by each write request.
+	static const size_t writeChunkSize = 4096;
+
+	/** Connect to a SFTP server.
+	 \param domain the server address
+	 \param user the user name
+	 \param port the server port
+	 \param knownHosts optional known hosts file to check the server key against, instead of the user one
+	 */
+	Server(const std::string & domain, const std::string & user, const int port, const fs::path & knownHosts = "");
 	
 	bool authenticate(const std::string & password);
 	
-	void disconnect();
-	
-	bool copyItem(const fs::path & src, const fs::path & dst, bool force);
+	void disconnect() override;
+
+	/// Check that the connection is still open, preventing the server from closing it for inactivity.
+	bool keepAlive() override;
 	
-	bool createDirectory(const fs::path & path, bool force = false);
+	bool copyItem(const fs::path & src, const fs::path & dst, bool force) override;
+
+	/// Removal if replacing, then open, one write per chunk, close.
+	uint64_t copyOperations(uint64_t size, bool replace) const override { return (replace ? 4 : 2) + (size + writeChunkSize - 1) / writeChunkSize; }
 	
-	bool removeItem(const fs::path & path);
+	bool createDirectory(const fs::path & path, bool force = false) override;
 	
-	bool itemExists(const fs::path & path, uint64_t& size);
+	bool removeItem(const fs::path & path) override;
+
+	bool removeItems(const std::vector<Item> & items) override;
 
-	bool itemExists(const fs::path & path);
+	bool renameItem(const fs::path & src, const fs::path & dst) override;
 
-	const Stats& stats() const { return _stats; }
+	bool listItems(const fs::path & path, bool recursive, std::vector<Item> & items) override;
 
-	void resetStats();
+	using DeployTarget::itemExists;
+	
+	bool itemExists(const fs::path & path, uint64_t& size) override;
+
+	bool readLink(const fs::path & path, fs::path & target) override;
+
+	void setLinkDuplicates(bool enable, const fs::path & storeDir) override { _linkDuplicates = enable; _storeDir = storeDir; _remoteFiles.clear(); }
 	
 private:
 	
 	int verifyHost();
 
-	Stats _stats;
+	/** Read the next entry of a directory. Entries are received in batches, only the calls requesting a new batch from the server are measured.
+	 \param dir the open directory
+	 \return the entry attributes, or null at the end of the directory or on error
+	 */
+	sftp_attributes readDirectory(sftp_dir dir);
+
+	/** Move a file content to the store, named after its hash, and replace the file by a link to it. Stored files are not modified by regular uploads, so links to them stay valid when the original file is replaced or removed.
+	 \param path a remote file uploaded during this session, or its location in the store
+	 \param hash the content hash
+	 \param size the content size
+	 \param replace replace a stored copy already present, else it is kept if it has the same size
+	 \param stored will contain the location of the content in the store
+	 \return true if the content is in the store
+	 */
+	bool storeContent(const fs::path & path, uint64_t hash, uint64_t size, bool replace, fs::path & stored);
+
+	/// Remote location of each uploaded file content, indexed by hash.
+	std::unordered_map<uint64_t, fs::path> _remoteFiles;
+	fs::path _storeDir; ///< Directory containing duplicated contents.
 	ssh_session _ssh = 0;
 	sftp_session _sftp = 0;
 	int _verbosity = 0;
 	bool _connected = false;
+	bool _linkDuplicates = false;
 };
 
 
@@ -0,0 +1,253 @@
+#include "system/SearchIndex.hpp"
+#include "system/System.hpp"
+#include "system/TextUtilities.hpp"
+
+#include <map>
+#include <cstring>
+
+/// Shortest and longest indexed terms, in bytes.
+static const size_t minTermSize = 2;
+static const size_t maxTermSize = 32;
+
+static bool isTermChar(unsigned char c){
+	return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c >= 0x80;
+}
+
+static void writeVarint(std::string & data, uint32_t value){
+	while(value >= 0x80){
+		data.push_back(char((value & 0x7F) | 0x80));
+		value >>= 7;
+	}
+	data.push_back(char(value));
+}
+
+static std::string escapeJson(const std::string & str){
+	std::string res;
+	res.reserve(str.size() + 2);
+	for(const char c : str){
+		if(c == '"' || c == '\\'){
+			res.push_back('\\');
+			res.push_back(c);
+		} else if(static_cast<unsigned char>(c) < 0x20){
+			static const char* hexDigits = "0123456789abcdef";
+			res.append("\\u00");
+			res.push_back(hexDigits[(c >> 4) & 15]);
+			res.push_back(hexDigits[c & 15]);
+		} else {
+			res.push_back(c);
+		}
+	}
+	return res;
+}
+
+void SearchIndex::tokenize(const std::string & text, bool markup, uint32_t weight, std::vector<Term> & terms){
+	const size_t size = text.size();
+	std::string term;
+	const auto flush = [&term, &terms, weight](){
+		if(term.size() >= minTermSize && term.size() <= maxTermSize){
+			terms.push_back({ TextUtilities::hash(term), weight, term });
+		}
+		term.clear();
+	};
+	size_t i = 0;
+	while(i < size){
+		const unsigned char c = static_cast<unsigned char>(text[i]);
+		if(markup && c == '<'){
+			flush();
+			// Scripts and styles are not part of the text.
+			for(const char* element : { "script", "style" }){
+				const size_t elementSize = std::strlen(element);
+				if(text.compare(i + 1, elementSize, element) == 0){
+					const size_t end = text.find(std::string("</") + element, i + 1);
+					i = end == std::string::npos ? size : end;
+					break;
+				}
+			}
+			const size_t end = text.find('>', i);
+			i = end == std::string::npos ? size : end + 1;
+			continue;
+		}
+		if(markup && c == '&'){
+			// Entities separate words.
+			flush();
+			const size_t end = text.find(';', i);
+			i = (end != std::string::npos && end - i < 10) ? end + 1 : i + 1;
+			continue;
+		}
+		if(isTermChar(c)){
+			term.push_back(char((c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c));
+		} else {
+			flush();
+		}
+		++i;
+	}
+	flush();
+}
+
+std::string SearchIndex::shardName(const std::string & term){
+	static const char* hexDigits = "0123456789abcdef";
+	std::string name;
+	for(size_t i = 0; i < (std::min)(term.size(), size_t(2)); ++i){
+		const unsigned char c = static_cast<unsigned char>(term[i]);
+		if((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9')){
+			name.push_back(char(c));
+		} else {
+			name.push_back('_');
+			name.push_back(hexDigits[c >> 4]);
+			name.push_back(hexDigits[c & 15]);
+		}
+	}
+	return name;
+}
+
+void SearchIndex::add(const std::vector<Document> & documents){
+	// Distinct terms of each document, with their total weight. Sorting flat lists is faster than filling a map per document.
+	std::vector<std::vector<Term>> documentTerms(documents.size());
+	System::forEachParallel(documents.size(), [&documents, &documentTerms](size_t i){
+		const Document & document = documents[i];
+		std::vector<Term> & terms = documentTerms[i];
+		tokenize(document.title, false, 8, terms);
+		tokenize(document.keywords, false, 4, terms);
+		tokenize(document.html, true, 1, terms);
+		std::sort(terms.begin(), terms.end(), [](const Term & a, const Term & b){ return a.hash < b.hash; });
+		size_t count = 0;
+		for(size_t tid = 0; tid < terms.size(); ++tid){
+			if(count > 0 && terms[count - 1].hash == terms[tid].hash){
+				terms[count - 1].weight += terms[tid].weight;
+			} else {
+				std::swap(terms[count++], terms[tid]);
+			}
+		}
+		terms.resize(count);
+	});
+
+	// Merge posting lists, documents are numbered in order so that lists are sorted.
+	for(size_t did = 0; did < documentTerms.size(); ++did){
+		const uint32_t docId = uint32_t(_documents.size());
+		_documents.emplace_back(documents[did].title, documents[did].url);
+		for(Term & term : documentTerms[did]){
+			const auto id = _termIds.emplace(term.hash, uint32_t(_postings.size()));
+			if(id.second){
+				_postings.emplace_back();
+				_terms.push_back(std::move(term.text));
+			}
+			_postings[id.first->second].emplace_back(docId, term.weight);
+		}
+		documentTerms[did] = {};
+	}
+}
+
+std::vector<std::pair<std::string, std::string>> SearchIndex::files() const {
+	std::map<std::string, std::vector<std::pair<const std::string*, uint32_t>>> shardTerms;
+	for(uint32_t id = 0; id < uint32_t(_terms.size()); ++id){
+		shardTerms[shardName(_terms[id])].emplace_back(&_terms[id], id);
+	}
+
+	std::vector<std::pair<std::string, std::string>> files;
+	files.reserve(shardTerms.size() + 2);
+	std::string list = "[";
+	for(size_t did = 0; did < _documents.size(); ++did){
+		list += (did != 0 ? ",\n[\"" : "\n[\"") + escapeJson(_documents[did].first) + "\",\"" + escapeJson(_documents[did].second) + "\"]";
+	}
+	list += "\n]\n";
+	files.emplace_back("documents.json", list);
+
+	for(auto & shard : shardTerms){
+		std::sort(shard.second.begin(), shard.second.end(), [](const std::pair<const std::string*, uint32_t> & a, const std::pair<const std::string*, uint32_t> & b){ return *a.first < *b.first; });
+		std::string data;
+		writeVarint(data, uint32_t(shard.second.size()));
+		for(const auto & term : shard.second){
+			writeVarint(data, uint32_t(term.first->size()));
+			data.append(*term.first);
+			const auto & list = _postings[term.second];
+			writeVarint(data, uint32_t(list.size()));
+			uint32_t previous = 0;
+			for(const auto & posting : list){
+				writeVarint(data, posting.first - previous);
+				writeVarint(data, posting.second);
+				previous = posting.first;
+			}
+		}
+		files.emplace_back(shard.first + ".bin", data);
+	}
+	files.emplace_back("search.js", loader);
+	return files;
+}
+
+const std::string SearchIndex::loader = R"js(// Query the search index: thothSearch(query, indexUrl) returns a promise of the matching documents { title, url, score }, best first.
+// Each word of the query must match the start of an indexed term. Document urls are relative to the site root.
+(function(){
+	var shards = {};
+	var documents = {};
+	function load(url, json){
+		return fetch(url).then(function(r){ return r.ok ? (json ? r.json() : r.arrayBuffer()) : null; }).catch(function(){ return null; });
+	}
+	function shardName(word){
+		var bytes = new TextEncoder().encode(word).slice(0, 2), name = "";
+		for(var i = 0; i < bytes.length; ++i){
+			var c = bytes[i];
+			name += ((c >= 97 && c <= 122) || (c >= 48 && c <= 57)) ? String.fromCharCode(c) : "_" + (c < 16 ? "0" : "") + c.toString(16);
+		}
+		return name;
+	}
+	function parse(buffer){
+		var bytes = new Uint8Array(buffer || new ArrayBuffer(0)), pos = 0, decoder = new TextDecoder(), terms = [];
+		function varint(){
+			var value = 0, shift = 1, b;
+			do { b = bytes[pos++]; value += (b & 127) * shift; shift *= 128; } while(b & 128);
+			return value;
+		}
+		var count = bytes.length ? varint() : 0;
+		for(var t = 0; t < count; ++t){
+			var size = varint(), term = decoder.decode(bytes.subarray(pos, pos + size));
+			pos += size;
+			var postings = [], doc = 0, n = varint();
+			for(var p = 0; p < n; ++p){
+				doc += varint();
+				postings.push([doc, varint()]);
+			}
+			terms.push([term, postings]);
+		}
+		return terms;
+	}
+	window.thothSearch = function(query, indexUrl){
+		var root = indexUrl || "search/";
+		var words = query.replace(/[A-Z]/g, function(c){ return c.toLowerCase(); }).split(/[^a-z0-9\u0080-\uffff]+/).filter(function(w){ return new TextEncoder().encode(w).length >= 2; });
+		if(!words.length){
+			return Promise.resolve([]);
+		}
+		documents[root] = documents[root] || load(root + "documents.json", true);
+		var requests = [documents[root]].concat(words.map(function(word){
+			var name = root + shardName(word) + ".bin";
+			shards[name] = shards[name] || load(name, false).then(parse);
+			return shards[name];
+		}));
+		return Promise.all(requests).then(function(results){
+			var docs = results[0] || [], scores = null;
+			words.forEach(function(word, i){
+				var found = {};
+				results[i + 1].forEach(function(entry){
+					if(entry[0].lastIndexOf(word, 0) === 0){
+						var boost = entry[0].length === word.length ? 2 : 1;
+						entry[1].forEach(function(p){ found[p[0]] = (found[p[0]] || 0) + p[1] * boost; });
+					}
+				});
+				if(scores === null){
+					scores = found;
+					return;
+				}
+				var next = {};
+				for(var d in scores){
+					if(found[d]){
+						next[d] = scores[d] + found[d];
+					}
+				}
+				scores = next;
+			});
+			return Object.keys(scores).filter(function(d){ return docs[d]; }).sort(function(a, b){ return scores[b] - scores[a]; }).map(function(d){
+				return { title: docs[d][0], url: docs[d][1], score: scores[d] };
+			});
+		});
+	};
+})();
+)js";
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "Common.hpp"
+
+#include <unordered_map>
+
+
+/**
+ \brief Build a full-text search index that can be queried by a script in the browser. Terms are grouped in shards by their first two bytes, so that a query only downloads the shards of its words. Each shard stores the sorted terms and their posting lists, with delta-encoded document indices and weights written as variable-length integers.
+ \ingroup System
+ */
+class SearchIndex {
+public:
+
+	/// Content of a document to index.
+	struct Document {
+		std::string title;
+		std::string url; ///< Link to the document, relative to the site root.
+		std::string keywords;
+		std::string html; ///< Rendered content, tags are ignored.
+	};
+
+	/** Add documents to the index, processed in parallel. Only their terms are kept, so that documents can be added in batches and released.
+	 \param documents the documents to index, numbered in the order they are added
+	 */
+	void add(const std::vector<Document> & documents);
+
+	/** Generate the files of the index.
+	 \return the name and content of each file of the index: the documents list, the shards and the loader script
+	 */
+	std::vector<std::pair<std::string, std::string>> files() const;
+
+private:
+
+	/// Occurrences of a term in a document.
+	struct Term {
+		uint64_t hash;
+		uint32_t weight;
+		std::string text;
+	};
+
+	static void tokenize(const std::string & text, bool markup, uint32_t weight, std::vector<Term> & terms);
+
+	static std::string shardName(const std::string & term);
+
+	static const std::string loader;
+
+	std::vector<std::pair<std::string, std::string>> _documents; ///< Title and link of each document.
+	std::unordered_map<uint64_t, uint32_t> _termIds; ///< Index of each term, by hash.
+	std::vector<std::string> _terms; ///< Text of each term.
+	std::vector<std::vector<std::pair<uint32_t, uint32_t>>> _postings; ///< Documents containing each term, with the term weight.
+};
@@ -1,10 +1,31 @@
 #include "system/System.hpp"
 
+#include <xxhash/xxhash.h>
+
+#include <atomic>
+#include <cstring>
+
 #ifdef _WIN32
 #include <windows.h>
 #else
 #include <termios.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <cerrno>
+#endif
+
+#ifdef __linux__
+#include <sys/ioctl.h>
+#include <linux/fs.h>
+#endif
+
+#ifdef _MACOS
+#include <sys/clonefile.h>
+#endif
+
+#ifndef _WIN32
+#include <zlib.h>
 #endif
 
 #ifdef _WIN32
@@ -148,6 +169,167 @@ bool System::writeStringToFile(const std::string & str, const fs::path & path){
 	return true;
 }
 
+uint64_t System::hashFile(const fs::path & path){
+	std::ifstream file(System::widen(path.string()), std::ios::in | std::ios::binary);
+	if(!file.is_open()){
+		return 0;
+	}
+	XXH3_state_t* state = XXH3_createState();
+	XXH3_64bits_reset(state);
+	std::vector<char> buffer(65536);
+	while(file.read(buffer.data(), buffer.size()) || file.gcount() > 0){
+		XXH3_64bits_update(state, buffer.data(), size_t(file.gcount()));
+	}
+	const uint64_t hash = uint64_t(XXH3_64bits_digest(state));
+	XXH3_freeState(state);
+	return hash;
+}
+
+int64_t System::copyFile(const fs::path & src, const fs::path & dst){
+#if defined(__linux__)
+	const int srcFd = open(src.c_str(), O_RDONLY);
+	if(srcFd < 0){
+		return -1;
+	}
+	struct stat srcStat;
+	if(fstat(srcFd, &srcStat) != 0){
+		close(srcFd);
+		return -1;
+	}
+	const int dstFd = open(dst.c_str(), O_WRONLY | O_CREAT | O_TRUNC, srcStat.st_mode & 0777);
+	if(dstFd < 0){
+		close(srcFd);
+		return -1;
+	}
+	int64_t total = 0;
+	bool res = true;
+#ifdef FICLONE
+	// Share the blocks of the source if the filesystem supports it.
+	if(ioctl(dstFd, FICLONE, srcFd) == 0){
+		close(srcFd);
+		return close(dstFd) == 0 ? int64_t(srcStat.st_size) : -1;
+	}
+#endif
+	bool kernelCopy = true;
+	char buffer[65536];
+	while(true){
+		ssize_t len = 0;
+		if(kernelCopy){
+			// Copy without going through user space.
+			len = copy_file_range(srcFd, nullptr, dstFd, nullptr, size_t(1) << 30, 0);
+			if(len < 0 && total == 0 && (errno == EXDEV || errno == ENOSYS || errno == EINVAL || errno == EOPNOTSUPP)){
+				kernelCopy = false;
+				continue;
+			}
+		} else {
+			len = read(srcFd, buffer, sizeof(buffer));
+			ssize_t written = 0;
+			while(len > 0 && written < len){
+				const ssize_t res2 = write(dstFd, buffer + written, size_t(len - written));
+				if(res2 < 0){
+					len = -1;
+					break;
+				}
+				written += res2;
+			}
+		}
+		if(len < 0 && errno == EINTR){
+			continue;
+		}
+		if(len <= 0){
+			res = len == 0;
+			break;
+		}
+		total += len;
+	}
+	close(srcFd);
+	res = (close(dstFd) == 0) && res;
+	return res ? total : -1;
+#else
+	std::error_code ec;
+#ifdef _MACOS
+	// Clone on APFS, the destination must not exist.
+	fs::remove(dst, ec);
+	if(clonefile(src.c_str(), dst.c_str(), 0) == 0){
+		return int64_t(fs::file_size(dst, ec));
+	}
+#endif
+	fs::copy_file(src, dst, fs::copy_options::overwrite_existing, ec);
+	if(ec){
+		return -1;
+	}
+	return int64_t(fs::file_size(dst, ec));
+#endif
+}
+
+bool System::gzipFile(const fs::path & src, const fs::path & dst, int level){
+#ifdef _WIN32
+	(void)src; (void)dst; (void)level;
+	return false;
+#else
+	std::ifstream srcFile(System::widen(src.string()), std::ios::in | std::ios::binary);
+	std::ofstream dstFile(System::widen(dst.string()), std::ios::out | std::ios::binary | std::ios::trunc);
+	if(!srcFile.is_open() || !dstFile.is_open()){
+		return false;
+	}
+	z_stream stream;
+	std::memset(&stream, 0, sizeof(stream));
+	// Add 16 to the window bits to get a gzip header.
+	if(deflateInit2(&stream, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK){
+		return false;
+	}
+	std::vector<char> input(65536);
+	std::vector<char> output(65536);
+	bool res = true;
+	int flush = Z_NO_FLUSH;
+	while(flush != Z_FINISH){
+		srcFile.read(input.data(), input.size());
+		stream.next_in = reinterpret_cast<Bytef*>(input.data());
+		stream.avail_in = uInt(srcFile.gcount());
+		flush = srcFile.eof() ? Z_FINISH : Z_NO_FLUSH;
+		do {
+			stream.next_out = reinterpret_cast<Bytef*>(output.data());
+			stream.avail_out = uInt(output.size());
+			if(deflate(&stream, flush) == Z_STREAM_ERROR){
+				res = false;
+				break;
+			}
+			dstFile.write(output.data(), std::streamsize(output.size() - stream.avail_out));
+		} while(stream.avail_out == 0);
+		if(!res || srcFile.bad()){
+			res = false;
+			break;
+		}
+	}
+	deflateEnd(&stream);
+	dstFile.close();
+	return res && !dstFile.fail();
+#endif
+}
+
+void System::forEachParallel(size_t count, const std::function<void(size_t)> & func){
+	const size_t threadCount = (std::min)(count, size_t((std::max)(1u, (std::min)(std::thread::hardware_concurrency(), 8u))));
+	if(threadCount <= 1){
+		for(size_t i = 0; i < count; ++i){
+			func(i);
+		}
+		return;
+	}
+	std::atomic<size_t> next(0);
+	std::vector<std::thread> threads;
+	for(size_t tid = 0; tid < threadCount; ++tid){
+		threads.emplace_back([&next, &func, count](){
+			size_t i;
+			while((i = next++) < count){
+				func(i);
+			}
+		});
+	}
+	for(std::thread & thread : threads){
+		thread.join();
+	}
+}
+
 void System::setStdinPrintback(bool enable){
 #ifdef _WIN32
 	// \warn Untested.
@@ -5,6 +5,7 @@
 
 #include <ghc/filesystem.hpp>
 #include <thread>
+#include <functional>
 
 namespace fs = ghc::filesystem;
 
@@ -35,6 +36,29 @@ public:
 	static std::string loadStringFromFile(const fs::path & path);
 	
 	static bool writeStringToFile(const std::string & str, const fs::path & path);
+
+	static uint64_t hashFile(const fs::path & path);
+
+	/** Copy the content of a file, sharing its blocks or copying in the kernel when the filesystem supports it.
+	 \param src the source file
+	 \param dst the destination file, created or truncated
+	 \return the number of bytes copied, or -1 on failure
+	 */
+	static int64_t copyFile(const fs::path & src, const fs::path & dst);
+
+	/** Write a gzip compressed copy of a file.
+	 \param src the source file
+	 \param dst the compressed file
+	 \param level the compression level, from 1 to 9
+	 \return false on failure or if compression is not supported on this platform
+	 */
+	static bool gzipFile(const fs::path & src, const fs::path & dst, int level);
+
+	/** Run a task for each index on a small pool of threads.
+	 \param count the number of tasks
+	 \param func the task, receiving its index
+	 */
+	static void forEachParallel(size_t count, const std::function<void(size_t)> & func);
 	
 	static void setStdinPrintback(bool enable);
 
@@ -199,3 +199,36 @@ bool TextUtilities::hasUppercase(const std::string& str) {
 	const std::string letterCaps = "ABCDEFGHIJKLMNOPQRSTUVWXYZ";
 	return str.find_first_of(letterCaps) != std::string::npos;
 }
+
+std::string TextUtilities::dataUri(const std::string& data, const std::string& mimeType) {
+	static const char* hexDigits = "0123456789ABCDEF";
+	std::string uri = "data:" + mimeType;
+	if(hasSuffix(mimeType, "+xml") || hasPrefix(mimeType, "text/")){
+		// Escape characters that are not allowed in URIs or would end the attribute.
+		uri.append(",");
+		for(const char c : data){
+			const unsigned char byte = static_cast<unsigned char>(c);
+			if(byte < 0x20 || byte >= 0x7F || std::string("\"'%#&<>{}|\\^`[]").find(c) != std::string::npos){
+				uri.push_back('%');
+				uri.push_back(hexDigits[byte >> 4]);
+				uri.push_back(hexDigits[byte & 15]);
+			} else {
+				uri.push_back(c);
+			}
+		}
+		return uri;
+	}
+	static const char* base64Digits = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+	uri.append(";base64,");
+	uri.reserve(uri.size() + (data.size() + 2) / 3 * 4);
+	for(size_t i = 0; i < data.size(); i += 3){
+		const size_t count = (std::min)(data.size() - i, size_t(3));
+		uint32_t group = uint32_t(static_cast<unsigned char>(data[i])) << 16;
+		group |= count > 1 ? uint32_t(static_cast<unsigned char>(data[i + 1])) << 8 : 0u;
+		group |= count > 2 ? uint32_t(static_cast<unsigned char>(data[i + 2])) : 0u;
+		for(size_t k = 0; k < 4; ++k){
+			uri.push_back(k <= count ? base64Digits[(group >> (18 - 6 * k)) & 63] : '=');
+		}
+	}
+	return uri;
+}
@@ -73,4 +73,11 @@ public:
 	static std::string uppercaseFirst(const std::string& str);
 
 	static bool hasUppercase(const std::string& str);
+
+	/** Embed data in a URI. Text such as SVG is percent-encoded as it is smaller than base64.
+	 \param data the content to embed
+	 \param mimeType the type of the content
+	 \return the data URI
+	 */
+	static std::string dataUri(const std::string& data, const std::string& mimeType);
 };